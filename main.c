@@ -1,3 +1,4 @@
+#include "caot.h"
 #include "cbaselib.h"
 #include "cchunk.h"
 #include "cdebug.h"
@@ -159,15 +160,16 @@ int fileReader(CState *state, void *data, size_t size, const void *ud)
     return fread(data, size, 1, (FILE *)ud) != 1;
 }
 
-void compileScript(CState *state, const char *in, const char *out)
+bool compileScript(CState *state, const char *in, const char *out, bool strip)
 {
     char *script = readFile(in);
+    bool success = false;
 
     FILE *fout = fopen(out, "wb");
 
     if (cosmoV_compileString(state, script, in)) {
         CObjFunction *func = cosmoV_readClosure(*cosmoV_getTop(state, 0))->function;
-        cosmoD_dump(state, func, fileWriter, (void *)fout);
+        success = cosmoD_dump(state, func, fileWriter, (void *)fout, strip) == 0;
     } else {
         cosmoV_printBacktrace(state, cosmoV_readError(*cosmoV_pop(state)));
     }
@@ -175,29 +177,82 @@ void compileScript(CState *state, const char *in, const char *out)
     free(script);
     fclose(fout);
 
-    printf("[!] compiled %s to %s successfully!\n", in, out);
+    if (success)
+        printf("[!] compiled %s to %s successfully!\n", in, out);
+
+    return success;
+}
+
+bool compileNative(CState *state, const char *in, const char *out)
+{
+    char *script = readFile(in);
+    const char *name = strrchr(in, '/') != NULL ? strrchr(in, '/') + 1 : in;
+    size_t nameLen = strchr(name, '.') != NULL ? (size_t)(strchr(name, '.') - name) : strlen(name);
+    char loader[65];
+    bool success = false;
+
+    // the generated loader is named after the script, so "examples/fib.cosmo" -> cosmo_load_fib
+    snprintf(loader, sizeof(loader), "%.*s", (int)nameLen, name);
+
+    FILE *fout = fopen(out, "wb");
+
+    if (cosmoV_compileString(state, script, in)) {
+        CObjFunction *func = cosmoV_readClosure(*cosmoV_getTop(state, 0))->function;
+        success = cosmoA_compile(state, func, loader, fileWriter, (void *)fout) == 0;
+    } else {
+        cosmoV_printBacktrace(state, cosmoV_readError(*cosmoV_pop(state)));
+    }
+
+    free(script);
+    fclose(fout);
+
+    if (success)
+        printf("[!] compiled %s to %s successfully! (load it with cosmo_load_%s)\n", in, out,
+               loader);
+
+    return success;
 }
 
-void loadScript(CState *state, const char *in)
+bool loadScript(CState *state, const char *in)
 {
+    bool ret = true;
     FILE *file = fopen(in, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file \"%s\".\n", in);
+        return false;
+    }
+
     if (!cosmoV_undump(state, fileReader, file)) {
         cosmoV_printBacktrace(state, cosmoV_readError(*cosmoV_pop(state)));
-        return;
+        fclose(file);
+        return false;
     };
 
     printf("[!] loaded %s!\n", in);
-    if (!cosmoV_pcall(state, 0, 0))
+    if (!cosmoV_pcall(state, 0, 0)) {
         cosmoV_printBacktrace(state, cosmoV_readError(*cosmoV_pop(state)));
+        ret = false;
+    }
 
     fclose(file);
+    return ret; // let the caller know if the script failed
+}
+
+// frees the state before exiting, the GC's object list is packed into CObj's header so leak
+// checkers can't see objects that are still reachable through it
+static void exitFailure(CState *state)
+{
+    cosmoV_freeState(state);
+    exit(EXIT_FAILURE);
 }
 
 void printUsage(const char *name)
 {
-    printf("Usage: %s [-clsr] [args]\n\n", name);
+    printf("Usage: %s [-cSClsr] [args]\n\n", name);
     printf("available options are:\n"
            "-c <in> <out>\tcompile <in> and dump to <out>\n"
+           "-S <in> <out>\tcompile <in> and dump to <out> without line info\n"
+           "-C <in> <out>\tcompile <in> to C source and write it to <out>\n"
            "-l <in>\t\tload dump from <in>\n"
            "-s <in...>\tcompile and run <in...> script(s)\n"
            "-r\t\tstart the repl\n\n");
@@ -212,23 +267,36 @@ int main(int argc, char *const argv[])
 
     int opt;
     bool isValid = false;
-    while ((opt = getopt(argc, argv, "clsr")) != -1) {
+    while ((opt = getopt(argc, argv, "cSClsr")) != -1) {
         switch (opt) {
         case 'c':
+        case 'S':
+            if (optind >= argc - 1) {
+                printf("Usage: %s -%c <in> <out>\n", argv[0], opt);
+                exitFailure(state);
+            } else if (!compileScript(state, argv[optind], argv[optind + 1], opt == 'S')) {
+                printf("failed to compile %s!\n", argv[optind]);
+                exitFailure(state);
+            }
+            isValid = true;
+            break;
+        case 'C':
             if (optind >= argc - 1) {
-                printf("Usage: %s -c <in> <out>\n", argv[0]);
-                exit(EXIT_FAILURE);
-            } else {
-                compileScript(state, argv[optind], argv[optind + 1]);
+                printf("Usage: %s -C <in> <out>\n", argv[0]);
+                exitFailure(state);
+            } else if (!compileNative(state, argv[optind], argv[optind + 1])) {
+                printf("failed to compile %s!\n", argv[optind]);
+                exitFailure(state);
             }
             isValid = true;
             break;
         case 'l':
             if (optind >= argc) {
                 printf("Usage: %s -l <in>\n", argv[0]);
-                exit(EXIT_FAILURE);
-            } else {
-                loadScript(state, argv[optind]);
+                exitFailure(state);
+            } else if (!loadScript(state, argv[optind])) {
+                printf("failed to load %s!\n", argv[optind]);
+                exitFailure(state);
             }
             isValid = true;
             break;
@@ -236,7 +304,7 @@ int main(int argc, char *const argv[])
             for (int i = optind; i < argc; i++) {
                 if (!runFile(state, argv[i])) {
                     printf("failed to run %s!\n", argv[i]);
-                    exit(EXIT_FAILURE);
+                    exitFailure(state);
                 }
             }
             isValid = true;
@@ -0,0 +1,447 @@
+#include "caot.h"
+
+#include "cchunk.h"
+#include "cdump.h"
+#include "coperators.h"
+#include "cstate.h"
+#include "cundump.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+    the generated C is a straight translation of the bytecode, one block per instruction with a
+    label on every jump target. locals, constants, jumps & number arithmetic are written out
+    inline, opcodes with an existing C entrypoint (cosmoV_call, cosmoV_concat, etc.) call it
+    directly & everything else (globals, indexing, fields, methods, iterators, closures, the
+    remaining operators, ...) goes through cosmoV_step, so the generated code never has to know
+    about the interpreter's internals. the bytecode is embedded alongside it, since stepping,
+    backtraces & the debug library still need the chunk.
+*/
+
+#define AOT_NAMEMAX 64
+
+typedef struct
+{
+    CState *state;
+    cosmo_Writer writer;
+    const void *userData;
+    int writerStatus;
+    int functions; // # of functions written so far
+} AOTState;
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t count;
+    size_t capacity;
+} AOTBuffer;
+
+typedef struct
+{
+    const uint8_t *buf;
+    size_t size;
+    size_t offset;
+} AOTReader;
+
+static void writef(AOTState *A, const char *format, ...)
+{
+    char buf[256];
+    char *str = buf;
+    va_list args;
+    int len;
+
+    if (A->writerStatus != 0)
+        return;
+
+    va_start(args, format);
+    len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (len < 0) {
+        A->writerStatus = 1;
+        return;
+    }
+
+    // most lines fit in buf, but function names come from the script & can be any length
+    if ((size_t)len >= sizeof(buf)) {
+        if ((str = malloc((size_t)len + 1)) == NULL) {
+            A->writerStatus = 1;
+            return;
+        }
+
+        va_start(args, format);
+        vsnprintf(str, (size_t)len + 1, format, args);
+        va_end(args);
+    }
+
+    A->writerStatus = A->writer(A->state, str, len, A->userData);
+
+    if (str != buf)
+        free(str);
+}
+
+static int bufferWriter(CState *state, const void *data, size_t size, const void *ud)
+{
+    AOTBuffer *buffer = (AOTBuffer *)ud;
+
+    if (buffer->count + size > buffer->capacity) {
+        size_t capacity = buffer->capacity == 0 ? 256 : buffer->capacity;
+        uint8_t *buf;
+
+        while (buffer->count + size > capacity)
+            capacity *= 2;
+
+        if ((buf = realloc(buffer->buf, capacity)) == NULL)
+            return 1;
+
+        buffer->buf = buf;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(&buffer->buf[buffer->count], data, size);
+    buffer->count += size;
+    return 0;
+}
+
+static int bufferReader(CState *state, void *data, size_t size, const void *ud)
+{
+    AOTReader *reader = (AOTReader *)ud;
+
+    if (reader->offset + size > reader->size)
+        return 1;
+
+    memcpy(data, &reader->buf[reader->offset], size);
+    reader->offset += size;
+    return 0;
+}
+
+static uint16_t readUInt(CChunk *chunk, int offset)
+{
+    uint16_t val;
+    memcpy(&val, &chunk->buf[offset], sizeof(uint16_t));
+    return val;
+}
+
+static bool isCompare(INSTRUCTION op)
+{
+    return op == OP_LESS || op == OP_GREATER || op == OP_LESS_EQUAL || op == OP_GREATER_EQUAL;
+}
+
+static const char *operatorStr(INSTRUCTION op)
+{
+    switch (op) {
+    case OP_ADD:
+        return "+";
+    case OP_SUB:
+        return "-";
+    case OP_MULT:
+        return "*";
+    case OP_DIV:
+        return "/";
+    case OP_LESS:
+        return "<";
+    case OP_GREATER:
+        return ">";
+    case OP_LESS_EQUAL:
+        return "<=";
+    default:
+        return ">=";
+    }
+}
+
+// the cvalue.h helper used when both operands of an arithmetic op are integers
+static const char *integerOpStr(INSTRUCTION op)
+{
+    switch (op) {
+    case OP_ADD:
+        return "cosmoV_addInteger";
+    case OP_SUB:
+        return "cosmoV_subInteger";
+    case OP_MULT:
+        return "cosmoV_mulInteger";
+    default:
+        return "cosmoV_divInteger";
+    }
+}
+
+// returns the bytecode offset the jump at offset goes to, or -1 if it isn't a jump
+static int jumpTarget(CChunk *chunk, int offset)
+{
+    int next = offset + instrSizeChunk(chunk, offset);
+
+    switch (genericOpcode(chunk->buf[offset])) {
+    case OP_JMP:
+    case OP_PEJMP:
+    case OP_EJMP:
+        return next + readUInt(chunk, offset + 1);
+    case OP_JMPBACK:
+        return next - readUInt(chunk, offset + 1);
+    case OP_NEXT:
+        return next + readUInt(chunk, offset + 2);
+    default:
+        return -1;
+    }
+}
+
+// a comparison is fused with the OP_PEJMP after it, unless something else jumps between them
+static bool isFused(CChunk *chunk, bool *labels, int offset)
+{
+    int next = offset + instrSizeChunk(chunk, offset);
+
+    return isCompare(genericOpcode(chunk->buf[offset])) && next < (int)chunk->count &&
+           !labels[next] && genericOpcode(chunk->buf[next]) == OP_PEJMP;
+}
+
+static void writeInstruction(AOTState *A, CChunk *chunk, bool *labels, int offset)
+{
+    INSTRUCTION op = genericOpcode(chunk->buf[offset]);
+    int next = offset + instrSizeChunk(chunk, offset);
+    int target = jumpTarget(chunk, offset);
+
+    switch (op) {
+    case OP_LOADCONST:
+        writef(A, "    cosmoV_pushValue(state, constants[%d]);\n", readUInt(chunk, offset + 1));
+        break;
+    case OP_GETLOCAL:
+        writef(A, "    cosmoV_pushValue(state, base[%d]);\n", chunk->buf[offset + 1]);
+        break;
+    case OP_SETLOCAL:
+        writef(A, "    base[%d] = *cosmoV_pop(state);\n", chunk->buf[offset + 1]);
+        break;
+    case OP_GETUPVAL:
+        writef(A, "    cosmoV_pushValue(state, *frame->closure->upvalues[%d]->val);\n",
+               chunk->buf[offset + 1]);
+        break;
+    case OP_SETUPVAL:
+        writef(A, "    *frame->closure->upvalues[%d]->val = *cosmoV_pop(state);\n",
+               chunk->buf[offset + 1]);
+        break;
+    case OP_POP:
+        writef(A, "    cosmoV_setTop(state, %d);\n", chunk->buf[offset + 1]);
+        break;
+    case OP_TRUE:
+    case OP_FALSE:
+        writef(A, "    cosmoV_pushBoolean(state, %s);\n", op == OP_TRUE ? "true" : "false");
+        break;
+    case OP_NIL:
+        writef(A, "    cosmoV_pushValue(state, cosmoV_newNil());\n");
+        break;
+    case OP_NOT:
+        writef(A, "    cosmoV_pushBoolean(state, cosmoA_isFalsey(cosmoV_pop(state)));\n");
+        break;
+    case OP_EQUAL: // __equal metamethods can run (& error), so the pc has to be up to date
+        writef(A, "    frame->pc = &code[%d];\n    COSMOA_EQUAL();\n", next);
+        break;
+    case OP_JMP:
+    case OP_JMPBACK:
+        writef(A, "    goto L%d;\n", target);
+        break;
+    case OP_PEJMP:
+        writef(A, "    if (cosmoA_isFalsey(cosmoV_pop(state)))\n        goto L%d;\n", target);
+        break;
+    case OP_EJMP:
+        writef(A, "    if (cosmoA_isFalsey(cosmoV_getTop(state, 0)))\n        goto L%d;\n",
+               target);
+        break;
+    case OP_NEXT:
+        writef(A, "    COSMOA_STEP(%d);\n    if (frame->pc != &code[%d])\n        goto L%d;\n",
+               offset, next, target);
+        break;
+    case OP_CALL:
+        writef(A, "    frame->pc = &code[%d];\n    cosmoV_call(state, %d, %d);\n", next,
+               chunk->buf[offset + 1], chunk->buf[offset + 2]);
+        break;
+    case OP_CONCAT:
+        writef(A, "    frame->pc = &code[%d];\n    cosmoV_concat(state, %d);\n", next,
+               chunk->buf[offset + 1]);
+        break;
+    case OP_NEWTABLE:
+    case OP_NEWOBJECT:
+        writef(A, "    frame->pc = &code[%d];\n    %s(state, %d);\n", next,
+               op == OP_NEWTABLE ? "cosmoV_makeTable" : "cosmoV_makeObject",
+               readUInt(chunk, offset + 1));
+        break;
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MULT:
+    case OP_DIV:
+        writef(A, "    COSMOA_ARITH(%d, %s, %s);\n", offset, operatorStr(op), integerOpStr(op));
+        break;
+    case OP_LESS:
+    case OP_GREATER:
+    case OP_LESS_EQUAL:
+    case OP_GREATER_EQUAL:
+        if (isFused(chunk, labels, offset)) {
+            writef(A, "    COSMOA_COMPAREJMP(%d, %s, L%d);\n", offset, operatorStr(op),
+                   jumpTarget(chunk, next));
+        } else {
+            writef(A, "    COSMOA_STEP(%d);\n", offset);
+        }
+        break;
+    case OP_INCLOCAL: {
+        int inc = chunk->buf[offset + 1] - 128;
+        int indx = chunk->buf[offset + 2];
+
+        writef(A, "    if (IS_NUMBER(base[%d])) {\n", indx);
+        writef(A, "        cosmoV_pushValue(state, base[%d]);\n", indx);
+        writef(A, "        base[%d] = cosmoV_incNumber(base[%d], %d);\n", indx, indx, inc);
+        writef(A, "    } else {\n        COSMOA_STEP(%d);\n    }\n", offset);
+        break;
+    }
+    case OP_RETURN:
+        writef(A, "    return %d;\n", chunk->buf[offset + 1]);
+        break;
+    default:
+        writef(A, "    COSMOA_STEP(%d);\n", offset);
+        break;
+    }
+}
+
+static void writeFunction(AOTState *A, CObjFunction *func)
+{
+    CChunk *chunk = &func->chunk;
+    bool *labels = calloc(chunk->count + 1, sizeof(bool));
+    int id = A->functions++;
+    int offset;
+
+    if (labels == NULL) {
+        A->writerStatus = 1;
+        return;
+    }
+
+    for (offset = 0; offset < (int)chunk->count; offset += instrSizeChunk(chunk, offset)) {
+        int target = jumpTarget(chunk, offset);
+        if (target >= 0 && target <= (int)chunk->count)
+            labels[target] = true;
+    }
+
+    writef(A, "// %s\n", func->name != NULL ? func->name->str : UNNAMEDCHUNK);
+    writef(A, "static int cosmoA_fn%d(CState *state, CCallFrame *frame)\n{\n", id);
+    writef(A, "    INSTRUCTION *code = frame->closure->function->chunk.buf;\n");
+    writef(A, "    CValue *constants = frame->closure->function->chunk.constants.values;\n");
+    writef(A, "    StkPtr base = frame->base;\n\n");
+    writef(A, "    (void)code;\n    (void)constants;\n    (void)base;\n\n");
+
+    for (offset = 0; offset < (int)chunk->count; offset += instrSizeChunk(chunk, offset)) {
+        if (labels[offset])
+            writef(A, "L%d:;\n", offset);
+
+        writeInstruction(A, chunk, labels, offset);
+
+        // the fused OP_PEJMP was already written
+        if (isFused(chunk, labels, offset))
+            offset += instrSizeChunk(chunk, offset);
+    }
+
+    // the chunk always ends with an OP_RETURN, but a label might still point past it
+    if (labels[chunk->count])
+        writef(A, "L%d:;\n", (int)chunk->count);
+    writef(A, "    return 0;\n}\n\n");
+
+    free(labels);
+
+    for (int i = 0; i < chunk->constants.count; i++) {
+        CValue constant = chunk->constants.values[i];
+        if (IS_FUNCTION(constant))
+            writeFunction(A, cosmoV_readFunction(constant));
+    }
+}
+
+static int countFunctions(CObjFunction *func)
+{
+    int count = 1;
+
+    for (int i = 0; i < func->chunk.constants.count; i++) {
+        CValue constant = func->chunk.constants.values[i];
+        if (IS_FUNCTION(constant))
+            count += countFunctions(cosmoV_readFunction(constant));
+    }
+
+    return count;
+}
+
+// assigns natives in the same order writeFunction visited the functions
+static void setNatives(CObjFunction *func, const CosmoNative *natives, int *i)
+{
+    func->native = natives[(*i)++];
+
+    for (int j = 0; j < func->chunk.constants.count; j++) {
+        CValue constant = func->chunk.constants.values[j];
+        if (IS_FUNCTION(constant))
+            setNatives(cosmoV_readFunction(constant), natives, i);
+    }
+}
+
+int cosmoA_compile(CState *state, CObjFunction *func, const char *name, cosmo_Writer writer,
+                   const void *userData)
+{
+    AOTState A = {state, writer, userData, 0, 0};
+    AOTBuffer dump = {NULL, 0, 0};
+    char ident[AOT_NAMEMAX + 1];
+    size_t i;
+
+    // the loader's name has to be a valid C identifier
+    for (i = 0; name[i] != '\0' && i < AOT_NAMEMAX; i++)
+        ident[i] = isalnum((unsigned char)name[i]) ? name[i] : '_';
+    ident[i] = '\0';
+
+    if (cosmoD_dump(state, func, bufferWriter, &dump, false)) {
+        free(dump.buf);
+        return 1;
+    }
+
+    writef(&A, "// generated by cosmoA_compile, do not edit\n\n#include \"caot.h\"\n\n");
+    writef(&A, "static const uint8_t cosmoA_dump[] = {");
+    for (i = 0; i < dump.count; i++)
+        writef(&A, "%s0x%02x,", i % 16 == 0 ? "\n    " : " ", dump.buf[i]);
+    writef(&A, "\n};\n\n");
+    free(dump.buf);
+
+    writeFunction(&A, func);
+
+    writef(&A, "static const CosmoNative cosmoA_natives[] = {\n");
+    for (int j = 0; j < A.functions; j++)
+        writef(&A, "    cosmoA_fn%d,\n", j);
+    writef(&A, "};\n\n");
+
+    writef(&A, "bool cosmo_load_%s(CState *state)\n{\n", ident);
+    writef(&A, "    return cosmoA_load(state, cosmoA_dump, sizeof(cosmoA_dump), cosmoA_natives, "
+               "%d);\n}\n",
+           A.functions);
+
+    return A.writerStatus;
+}
+
+bool cosmoA_load(CState *state, const uint8_t *dump, size_t size, const CosmoNative *natives,
+                 int count)
+{
+    AOTReader reader = {dump, size, 0};
+    CObjFunction *func;
+    CPanic *panic = cosmoV_newPanic(state);
+    int found, i = 0;
+
+    // the dump is verified while it's read, a bad one throws an error which we catch here
+    if (cosmoV_protect(panic)) {
+        if (cosmoD_undump(state, bufferReader, &reader, &func))
+            cosmoV_error(state, "failed to read dump!");
+
+        if ((found = countFunctions(func)) != count) {
+            cosmoV_error(state, "native code doesn't match its dump! (%d functions, expected %d)",
+                         found, count);
+        }
+
+        setNatives(func, natives, &i);
+        cosmoV_freePanic(state);
+
+        // cosmoD_undump left the function on the stack, swap it for its closure
+        *cosmoV_getTop(state, 0) = cosmoV_newRef(cosmoO_newClosure(state, func));
+        return true;
+    }
+
+    cosmoV_freePanic(state);
+    return false;
+}
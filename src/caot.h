@@ -0,0 +1,87 @@
+#ifndef COSMO_AOT_H
+#define COSMO_AOT_H
+
+#include "cobj.h"
+#include "cosmo.h"
+#include "cvm.h"
+
+/*
+    ahead-of-time compiler, translates a function (& every function nested in its constants) into a
+    C source file. the generated file embeds the function's dump & exposes
+    `bool cosmo_load_<name>(CState *state)`, which behaves just like cosmoV_undump except every
+    function it loads runs the generated C instead of being interpreted.
+
+    only locals, upvalues, constants, jumps, calls, concat, table/object literals, equality &
+    number arithmetic/comparisons are translated. every other opcode (globals, indexing, fields,
+    methods, iterators, closures, ...) is still dispatched one instruction at a time through
+    cosmoV_step, so those keep paying the interpreter's dispatch cost.
+
+    returns non-zero on error
+*/
+COSMO_API int cosmoA_compile(CState *state, CObjFunction *func, const char *name,
+                             cosmo_Writer writer, const void *userData);
+
+/*
+    used by the generated code, undumps the embedded dump & assigns natives[i] to the i'th function
+    (in the order cosmoA_compile visited them). pushes the <closure> or <error> onto the stack like
+    cosmoV_undump
+*/
+COSMO_API bool cosmoA_load(CState *state, const uint8_t *dump, size_t size,
+                           const CosmoNative *natives, int count);
+
+// helpers for the generated code, these expect `state`, `frame` & `code` to be in scope
+
+// runs the instruction at offset through the interpreter
+#define COSMOA_STEP(offset) (frame->pc = &code[offset], cosmoV_step(state))
+
+// OP_EQUAL, cosmoV_equal handles __equal metamethods
+#define COSMOA_EQUAL()                                                                             \
+    do {                                                                                           \
+        StkPtr valB = cosmoV_pop(state);                                                           \
+        StkPtr valA = cosmoV_pop(state);                                                           \
+        cosmoV_pushBoolean(state, cosmoV_equal(state, *valA, *valB));                              \
+    } while (0)
+
+// number fast path for OP_ADD, OP_SUB, etc. anything else is left to the interpreter. intOp is
+// the cvalue.h helper for two integers
+#define COSMOA_ARITH(offset, op, intOp)                                                            \
+    do {                                                                                           \
+        StkPtr valA = cosmoV_getTop(state, 1);                                                     \
+        StkPtr valB = cosmoV_getTop(state, 0);                                                     \
+        if (IS_INTEGER(*valA) && IS_INTEGER(*valB)) {                                              \
+            *valA = intOp(cosmoV_readInteger(*valA), cosmoV_readInteger(*valB));                   \
+            state->top--;                                                                          \
+        } else if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {                                         \
+            *valA = cosmoV_newNumber(cosmoV_readNumber(*valA) op cosmoV_readNumber(*valB));        \
+            state->top--;                                                                          \
+        } else {                                                                                   \
+            COSMOA_STEP(offset);                                                                   \
+        }                                                                                          \
+    } while (0)
+
+// a comparison followed by an OP_PEJMP, jumps to label if the comparison is false
+#define COSMOA_COMPAREJMP(offset, op, label)                                                       \
+    do {                                                                                           \
+        StkPtr valA = cosmoV_getTop(state, 1);                                                     \
+        StkPtr valB = cosmoV_getTop(state, 0);                                                     \
+        if (IS_INTEGER(*valA) && IS_INTEGER(*valB)) {                                              \
+            state->top -= 2;                                                                       \
+            if (!(cosmoV_readInteger(*valA) op cosmoV_readInteger(*valB)))                         \
+                goto label;                                                                        \
+        } else if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {                                         \
+            state->top -= 2;                                                                       \
+            if (!(cosmoV_readNumber(*valA) op cosmoV_readNumber(*valB)))                           \
+                goto label;                                                                        \
+        } else {                                                                                   \
+            COSMOA_STEP(offset);                                                                   \
+            if (cosmoA_isFalsey(cosmoV_pop(state)))                                                \
+                goto label;                                                                        \
+        }                                                                                          \
+    } while (0)
+
+static inline bool cosmoA_isFalsey(StkPtr val)
+{
+    return IS_NIL(*val) || (IS_BOOLEAN(*val) && !cosmoV_readBoolean(*val));
+}
+
+#endif
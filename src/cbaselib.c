@@ -7,6 +7,7 @@
 #include "cvalue.h"
 #include "cvm.h"
 
+#include <limits.h>
 #include <math.h>
 
 // ================================================================ [BASELIB]
@@ -145,6 +146,7 @@ void cosmoB_loadLibrary(CState *state)
     cosmoB_loadObjLib(state);
     cosmoB_loadStrLib(state);
     cosmoB_loadMathLib(state);
+    cosmoB_loadTblLib(state);
 }
 
 // ================================================================ [OBJECT.*]
@@ -200,7 +202,8 @@ int cosmoB_ogetKeys(CState *state, int nargs, CValue *args)
         if (IS_NIL(entry->key))
             continue;
 
-        cosmoV_pushNumber(state, indx++);
+        cosmoV_checkStack(state, 2);
+        cosmoV_pushInteger(state, indx++);
         cosmoV_pushValue(state, entry->key);
     }
 
@@ -286,7 +289,7 @@ int fileB_read(CState *state, int nargs, CValue *args)
 
     if (IS_NUMBER(args[1])) {
         CValue temp;
-        char *buffer;
+        CObjString *buffer;
         cosmo_Number length = cosmoV_readNumber(args[1]);
 
         // make sure the length is within the bounds of the file
@@ -295,19 +298,18 @@ int fileB_read(CState *state, int nargs, CValue *args)
         }
 
         // allocate a buffer for the read data
-        buffer = cosmoM_xmalloc(state, (size_t)length + 1);
+        buffer = cosmoO_newStringBuffer(state, (size_t)length);
 
         // read the data
-        fread(buffer, sizeof(char), (size_t)length, file);
-        buffer[(int)length] = '\0'; // write the NULL terminator
+        fread(buffer->str, sizeof(char), (size_t)length, file);
 
         // push the read data
-        temp = cosmoV_newRef(cosmoO_takeString(state, buffer, (size_t)length));
+        temp = cosmoV_newRef(cosmoO_internString(state, buffer));
         cosmoV_pushValue(state, temp);
     } else if (IS_STRING(args[1])) {
         if (strcmp(cosmoV_readCString(args[1]), "a") == 0) {
             CValue temp;
-            char *buffer;
+            CObjString *buffer;
             long length;
 
             // get the length of the file
@@ -316,14 +318,13 @@ int fileB_read(CState *state, int nargs, CValue *args)
             fseek(file, 0, SEEK_SET);
 
             // allocate a buffer for the read data
-            buffer = cosmoM_xmalloc(state, (size_t)length + 1);
+            buffer = cosmoO_newStringBuffer(state, (size_t)length);
 
             // read the data
-            fread(buffer, sizeof(char), (size_t)length, file);
-            buffer[length] = '\0'; // write the NULL terminator
+            fread(buffer->str, sizeof(char), (size_t)length, file);
 
             // push the read data
-            temp = cosmoV_newRef(cosmoO_takeString(state, buffer, (size_t)length));
+            temp = cosmoV_newRef(cosmoO_internString(state, buffer));
             cosmoV_pushValue(state, temp);
         } else {
             cosmoV_error(state, "file:read() expected \"a\" or <number>, got \"%s\"!",
@@ -526,7 +527,8 @@ int cosmoB_sSub(CState *state, int nargs, CValue *args)
                          indx);
         }
 
-        cosmoV_pushLString(state, str->str + ((int)indx), str->length - ((int)indx));
+        cosmoV_pushRef(state, (CObj *)cosmoO_sliceString(state, str, (int)indx,
+                                                         str->length - ((int)indx)));
     } else if (nargs == 3) {
         if (!IS_STRING(args[0]) || !IS_NUMBER(args[1]) || !IS_NUMBER(args[2])) {
             cosmoV_typeError(state, "string.sub()", "<string>, <number>, <number>", "%s, %s, %s",
@@ -545,7 +547,7 @@ int cosmoB_sSub(CState *state, int nargs, CValue *args)
                 str->length);
         }
 
-        cosmoV_pushLString(state, str->str + ((int)indx), ((int)length));
+        cosmoV_pushRef(state, (CObj *)cosmoO_sliceString(state, str, (int)indx, (int)length));
     } else {
         cosmoV_error(state, "string.sub() expected 2 or 3 arguments, got %d!", nargs);
     }
@@ -569,12 +571,12 @@ int cosmoB_sFind(CState *state, int nargs, CValue *args)
 
         // failed, return the error index -1
         if (indx == NULL) {
-            cosmoV_pushNumber(state, -1);
+            cosmoV_pushInteger(state, -1);
             return 1;
         }
 
         // success! push the index
-        cosmoV_pushNumber(state, (cosmo_Number)(indx - str->str));
+        cosmoV_pushInteger(state, (cosmo_Integer)(indx - str->str));
     } else if (nargs == 3) {
         if (!IS_STRING(args[0]) || !IS_STRING(args[1]) || !IS_NUMBER(args[2])) {
             cosmoV_typeError(state, "string.find()", "<string>, <string>, <number>", "%s, %s, %s",
@@ -590,12 +592,12 @@ int cosmoB_sFind(CState *state, int nargs, CValue *args)
 
         // failed, return the error index -1
         if (indx == NULL) {
-            cosmoV_pushNumber(state, -1);
+            cosmoV_pushInteger(state, -1);
             return 1;
         }
 
         // success! push the index
-        cosmoV_pushNumber(state, (cosmo_Number)(indx - str->str));
+        cosmoV_pushInteger(state, (cosmo_Integer)(indx - str->str));
     } else {
         cosmoV_error(state, "string.find() expected 2 or 3 arguments, got %d!", nargs);
     }
@@ -625,10 +627,12 @@ int cosmoB_sSplit(CState *state, int nargs, CValue *args)
     // while there are still patterns to match in the string, push the split strings onto the stack
     do {
         nIndx = strstr(indx, ptrn->str);
+        size_t start = indx - str->str;
+        size_t length = nIndx == NULL ? str->length - start : (size_t)(nIndx - indx);
 
-        cosmoV_pushNumber(state, nEntries++);
-        cosmoV_pushLString(state, indx,
-                           nIndx == NULL ? str->length - (indx - str->str) : nIndx - indx);
+        cosmoV_checkStack(state, 2);
+        cosmoV_pushInteger(state, nEntries++);
+        cosmoV_pushRef(state, (CObj *)cosmoO_sliceString(state, str, start, length));
 
         indx = nIndx + ptrn->length;
     } while (nIndx != NULL);
@@ -658,7 +662,7 @@ int cosmoB_sByte(CState *state, int nargs, CValue *args)
     }
 
     // push the character byte and return
-    cosmoV_pushNumber(state, (int)str->str[0]);
+    cosmoV_pushInteger(state, (int)str->str[0]);
     return 1;
 }
 
@@ -697,7 +701,7 @@ int cosmoB_sLen(CState *state, int nargs, CValue *args)
         cosmoV_typeError(state, "string.len", "<string>", "%s", cosmoV_typeStr(args[0]));
     }
 
-    cosmoV_pushNumber(state, (cosmo_Number)strlen(cosmoV_readCString(args[0])));
+    cosmoV_pushInteger(state, (cosmo_Integer)strlen(cosmoV_readCString(args[0])));
 
     return 1;
 }
@@ -724,18 +728,15 @@ int cosmoB_sRep(CState *state, int nargs, CValue *args)
 
     // allocated the new buffer for the string
     size_t length = str->length * times;
-    char *newStr = cosmoM_xmalloc(state, length + 1); // + 1 for the NULL terminator
+    CObjString *newStr = cosmoO_newStringBuffer(state, length);
 
     // copy the string over the new buffer
     for (int i = 0; i < times; i++) {
-        memcpy(&newStr[i * str->length], str->str, str->length);
+        memcpy(&newStr->str[i * str->length], str->str, str->length);
     }
 
-    // write the NULL terminator
-    newStr[length] = '\0';
-
     // finally, push the resulting string onto the stack
-    cosmoV_pushRef(state, (CObj *)cosmoO_takeString(state, newStr, length));
+    cosmoV_pushRef(state, (CObj *)cosmoO_internString(state, newStr));
     return 1;
 }
 
@@ -776,7 +777,13 @@ int cosmoB_mAbs(CState *state, int nargs, CValue *args)
         cosmoV_typeError(state, "math.abs", "<number>", "%s", cosmoV_typeStr(args[0]));
     }
 
-    cosmoV_pushNumber(state, fabs(cosmoV_readNumber(args[0])));
+    if (IS_INTEGER(args[0]) && cosmoV_readInteger(args[0]) < 0) {
+        cosmoV_pushValue(state, cosmoV_subInteger(0, cosmoV_readInteger(args[0])));
+    } else if (IS_INTEGER(args[0])) {
+        cosmoV_pushValue(state, args[0]);
+    } else {
+        cosmoV_pushNumber(state, fabs(cosmoV_readNumber(args[0])));
+    }
     return 1;
 }
 
@@ -958,6 +965,76 @@ void cosmoB_loadMathLib(CState *state)
     cosmoV_addGlobals(state, 1);
 }
 
+// ================================================================ [TABLE.*]
+
+// table.setmode(tbl, mode), mode is "k", "v" or "kv"
+int cosmoB_tSetMode(CState *state, int nargs, CValue *args)
+{
+    if (nargs != 2) {
+        cosmoV_error(state, "table.setmode() expected 2 arguments, got %d!", nargs);
+    }
+
+    if (!IS_TABLE(args[0]) || !IS_STRING(args[1])) {
+        cosmoV_typeError(state, "table.setmode()", "<table>, <string>", "%s, %s",
+                         cosmoV_typeStr(args[0]), cosmoV_typeStr(args[1]));
+    }
+
+    cosmoO_setTableMode(cosmoV_readTable(args[0]), cosmoV_readCString(args[1]));
+
+    // return the table so it can be used inline, eg. `let cache = table.setmode([], "k")`
+    cosmoV_pushValue(state, args[0]);
+    return 1;
+}
+
+// table.new([narray], [nhash]), makes an empty table with room for narray + nhash entries
+int cosmoB_tNew(CState *state, int nargs, CValue *args)
+{
+    if (nargs > 2) {
+        cosmoV_error(state, "table.new() expected 0-2 arguments, got %d!", nargs);
+    }
+
+    cosmo_Number entries = 0;
+    for (int i = 0; i < nargs; i++) {
+        if (!IS_NUMBER(args[i])) {
+            cosmoV_typeError(state, "table.new()", "[<number>], [<number>]", "%s",
+                             cosmoV_typeStr(args[i]));
+        }
+
+        cosmo_Number n = cosmoV_readNumber(args[i]);
+        if (n < 0) {
+            cosmoV_error(state, "table.new() expected sizes >= 0, got %f!", n);
+        }
+
+        entries += n;
+    }
+
+    if (entries > INT_MAX / 2) {
+        cosmoV_error(state, "table.new() can't allocate %f entries!", entries);
+    }
+
+    cosmoV_pushRef(state, (CObj *)cosmoO_newTableSized(state, (int)entries));
+    return 1;
+}
+
+void cosmoB_loadTblLib(CState *state)
+{
+    const char *identifiers[] = {"new", "setmode"};
+
+    CosmoCFunction tblLib[] = {cosmoB_tNew, cosmoB_tSetMode};
+    int i;
+
+    // make table library object
+    cosmoV_pushString(state, "table");
+    for (i = 0; i < sizeof(identifiers) / sizeof(identifiers[0]); i++) {
+        cosmoV_pushString(state, identifiers[i]);
+        cosmoV_pushCFunction(state, tblLib[i]);
+    }
+
+    // make the object and register it as a global to the state
+    cosmoV_makeObject(state, i);
+    cosmoV_addGlobals(state, 1);
+}
+
 // ================================================================ [VM.*]
 
 // vm.__getter["globals"]
@@ -1065,6 +1142,74 @@ int cosmoB_vcollect(CState *state, int nargs, CValue *args)
     return 0;
 }
 
+// grabs a number option from the vm.gc() settings table, returns false if it isn't set
+static bool getGCOption(CState *state, CTable *tbl, const char *name, cosmo_Number *out)
+{
+    CValue val;
+
+    if (!cosmoT_get(state, tbl, cosmoV_newRef(cosmoO_copyString(state, name, strlen(name))),
+                    &val) ||
+        IS_NIL(val))
+        return false;
+
+    if (!IS_NUMBER(val) || cosmoV_readNumber(val) < 0) {
+        cosmoV_error(state, "vm.gc() expected a positive <number> for '%s', got %s!", name,
+                     cosmoV_typeStr(val));
+    }
+
+    *out = cosmoV_readNumber(val);
+    return true;
+}
+
+// vm.gc({pause = 200, step = 0, min = 8192, limit = 0}), returns the current settings
+int cosmoB_vgc(CState *state, int nargs, CValue *args)
+{
+    if (nargs > 1) {
+        cosmoV_error(state, "Expected 0 or 1 arguments, got %d!", nargs);
+    }
+
+    if (nargs == 1) {
+        CTable *tbl;
+        cosmo_Number num;
+        int pause = state->gcPause;
+        size_t step = state->gcStep, min = state->gcMin;
+
+        if (IS_OBJECT(args[0])) {
+            tbl = &cosmoV_readObject(args[0])->tbl;
+        } else if (IS_TABLE(args[0])) {
+            tbl = &cosmoV_readTable(args[0])->tbl;
+        } else {
+            cosmoV_typeError(state, "vm.gc()", "<object> or <table>", "%s",
+                             cosmoV_typeStr(args[0]));
+            return 0;
+        }
+
+        if (getGCOption(state, tbl, "pause", &num))
+            pause = (int)num;
+        if (getGCOption(state, tbl, "step", &num))
+            step = (size_t)num;
+        if (getGCOption(state, tbl, "min", &num))
+            min = (size_t)num;
+        if (getGCOption(state, tbl, "limit", &num))
+            cosmoM_setHeapLimit(state, (size_t)num);
+
+        cosmoM_setGCPacing(state, pause, step, min);
+    }
+
+    cosmoV_pushString(state, "pause");
+    cosmoV_pushNumber(state, state->gcPause);
+    cosmoV_pushString(state, "step");
+    cosmoV_pushNumber(state, state->gcStep);
+    cosmoV_pushString(state, "min");
+    cosmoV_pushNumber(state, state->gcMin);
+    cosmoV_pushString(state, "limit");
+    cosmoV_pushNumber(state, state->heapLimit);
+    cosmoV_pushString(state, "allocated");
+    cosmoV_pushNumber(state, state->allocatedBytes);
+    cosmoV_makeObject(state, 5);
+    return 1;
+}
+
 void cosmoB_loadVM(CState *state)
 {
     // make vm.* object
@@ -1103,7 +1248,10 @@ void cosmoB_loadVM(CState *state)
     cosmoV_pushString(state, "disassemble");
     cosmoV_pushCFunction(state, cosmoB_vdisassemble);
 
-    cosmoV_makeObject(state, 5); // makes the vm object
+    cosmoV_pushString(state, "gc");
+    cosmoV_pushCFunction(state, cosmoB_vgc);
+
+    cosmoV_makeObject(state, 6); // makes the vm object
 
     // register "vm" to the global table
     cosmoV_addGlobals(state, 1);
@@ -15,6 +15,7 @@ enum
     - object library
     - string library
     - math library
+    - table library
 */
 COSMO_API void cosmoB_loadLibrary(CState *state);
 
@@ -53,10 +54,17 @@ COSMO_API void cosmoB_loadStrLib(CState *state);
 */
 COSMO_API void cosmoB_loadMathLib(CState *state);
 
+/* loads the base table library, including:
+    - table.new (pre-sized tables)
+    - table.setmode (weak keys/values)
+*/
+COSMO_API void cosmoB_loadTblLib(CState *state);
+
 /* loads the vm library, including:
     - manually setting/grabbing base protos of any object (vm.baseProtos)
     - manually setting/grabbing the global table (vm.globals)
     - manually invoking a garbage collection event (vm.collect())
+    - tuning GC pacing & the heap limit (vm.gc())
     - printing closure disassemblies (vm.disassemble())
 
     for this reason, it is recommended to NOT load this library in production
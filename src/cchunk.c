@@ -17,6 +17,7 @@ void initChunk(CState *state, CChunk *chunk, size_t startCapacity)
     chunk->capacity = startCapacity;
     chunk->lineCapacity = startCapacity;
     chunk->count = 0;
+    chunk->lineCount = 0;
     chunk->buf = NULL; // when writeByteChunk is called, it'll allocate the array for us
     chunk->lineInfo = NULL;
 
@@ -29,7 +30,7 @@ void cleanChunk(CState *state, CChunk *chunk)
     // first, free the chunk buffer
     cosmoM_freeArray(state, INSTRUCTION, chunk->buf, chunk->capacity);
     // then the line info
-    cosmoM_freeArray(state, int, chunk->lineInfo, chunk->capacity);
+    cosmoM_freeArray(state, CLineInfo, chunk->lineInfo, chunk->lineCapacity);
     // free the constants
     cleanValArray(state, &chunk->constants);
 }
@@ -45,7 +46,9 @@ int addConstant(CState *state, CChunk *chunk, CValue value)
 {
     // before adding the constant, check if we already have it
     for (size_t i = 0; i < chunk->constants.count; i++) {
-        if (cosmoV_equal(state, value, chunk->constants.values[i]))
+        // 1 & 1.0 are equal but they aren't interchangeable constants
+        if (GET_TYPE(value) == GET_TYPE(chunk->constants.values[i]) &&
+            cosmoV_equal(state, value, chunk->constants.values[i]))
             return i; // we already have a matching constant!
     }
 
@@ -62,10 +65,15 @@ void writeu8Chunk(CState *state, CChunk *chunk, INSTRUCTION i, int line)
 {
     // does the buffer need to be reallocated?
     cosmoM_growArray(state, INSTRUCTION, chunk->buf, chunk->count, chunk->capacity);
-    cosmoM_growArray(state, int, chunk->lineInfo, chunk->count, chunk->lineCapacity);
+
+    // a new line starts a new run
+    if (chunk->lineCount == 0 || chunk->lineInfo[chunk->lineCount - 1].line != line) {
+        cosmoM_growArray(state, CLineInfo, chunk->lineInfo, chunk->lineCount, chunk->lineCapacity);
+        chunk->lineInfo[chunk->lineCount].offset = chunk->count;
+        chunk->lineInfo[chunk->lineCount++].line = line;
+    }
 
     // write data to the chunk :)
-    chunk->lineInfo[chunk->count] = line;
     chunk->buf[chunk->count++] = i;
 }
 
@@ -78,3 +86,477 @@ void writeu16Chunk(CState *state, CChunk *chunk, uint16_t i, int line)
         writeu8Chunk(state, chunk, buffer[i], line);
     }
 }
+
+// ================================================================ [READ FROM CHUNK]
+
+int getLineChunk(CChunk *chunk, int offset)
+{
+    int low = 0, high = (int)chunk->lineCount - 1, line = 0;
+
+    // find the last run starting at or before offset
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+
+        if (chunk->lineInfo[mid].offset <= offset) {
+            line = chunk->lineInfo[mid].line;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return line;
+}
+
+int instrSizeChunk(CChunk *chunk, int offset)
+{
+    switch (genericOpcode(chunk->buf[offset])) {
+    case OP_SETLOCAL:
+    case OP_GETLOCAL:
+    case OP_GETUPVAL:
+    case OP_SETUPVAL:
+    case OP_POP:
+    case OP_CONCAT:
+    case OP_INCINDEX:
+    case OP_RETURN:
+        return 2; // op + u8
+    case OP_LOADCONST:
+    case OP_SETGLOBAL:
+    case OP_GETGLOBAL:
+    case OP_PEJMP:
+    case OP_EJMP:
+    case OP_JMP:
+    case OP_JMPBACK:
+    case OP_CALL:
+    case OP_NEWTABLE:
+    case OP_NEWARRAY:
+    case OP_NEWOBJECT:
+    case OP_SETOBJECT:
+    case OP_GETOBJECT:
+    case OP_GETMETHOD:
+    case OP_INCLOCAL:
+    case OP_INCUPVAL:
+        return 3; // op + u16 or op + u8 + u8
+    case OP_NEXT:
+    case OP_INCGLOBAL:
+    case OP_INCOBJECT:
+        return 4; // op + u8 + u16
+    case OP_INVOKE:
+        return 5; // op + u8 + u8 + u16
+    case OP_CLOSURE: {
+        // op + u16, followed by an encoding & index pair for each upvalue
+        CValue func = chunk->constants.values[readu16Chunk(chunk, offset + 1)];
+        return 3 + ((CObjFunction *)cosmoV_readRef(func))->upvals * 2;
+    }
+    default:
+        return 1; // op
+    }
+}
+
+// sets how many values the instruction at offset pops & then pushes
+static void stackEffect(CChunk *chunk, int offset, int *pops, int *pushes)
+{
+    INSTRUCTION *instr = &chunk->buf[offset];
+
+    *pops = 0;
+    *pushes = 0;
+
+    switch (genericOpcode(instr[0])) {
+    case OP_LOADCONST:
+    case OP_GETGLOBAL:
+    case OP_GETLOCAL:
+    case OP_GETUPVAL:
+    case OP_CLOSURE:
+    case OP_INCLOCAL:
+    case OP_INCGLOBAL:
+    case OP_INCUPVAL:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_NIL:
+        *pushes = 1;
+        break;
+    case OP_SETGLOBAL:
+    case OP_SETLOCAL:
+    case OP_SETUPVAL:
+    case OP_PEJMP:
+    case OP_CLOSE:
+        *pops = 1;
+        break;
+    case OP_EJMP:
+    case OP_GETOBJECT:
+    case OP_GETMETHOD:
+    case OP_ITER:
+    case OP_NOT:
+    case OP_NEGATE:
+    case OP_BNOT:
+    case OP_COUNT:
+    case OP_INCOBJECT:
+        *pops = 1;
+        *pushes = 1;
+        break;
+    case OP_POP:
+    case OP_RETURN:
+        *pops = instr[1];
+        break;
+    case OP_CALL:
+    case OP_INVOKE:
+        *pops = instr[1] + 1; // + 1 for the function (or object)
+        *pushes = instr[2];
+        break;
+    case OP_NEWTABLE:
+    case OP_NEWOBJECT:
+        *pops = readu16Chunk(chunk, offset + 1) * 2;
+        *pushes = 1;
+        break;
+    case OP_NEWARRAY:
+        *pops = readu16Chunk(chunk, offset + 1);
+        *pushes = 1;
+        break;
+    case OP_CONCAT:
+        *pops = instr[1];
+        *pushes = 1;
+        break;
+    case OP_NEWINDEX:
+        *pops = 3;
+        break;
+    case OP_SETOBJECT:
+        *pops = 2;
+        break;
+    case OP_INDEX:
+    case OP_INCINDEX:
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MULT:
+    case OP_DIV:
+    case OP_MOD:
+    case OP_POW:
+    case OP_IDIV:
+    case OP_BAND:
+    case OP_BOR:
+    case OP_BXOR:
+    case OP_SHL:
+    case OP_SHR:
+    case OP_EQUAL:
+    case OP_LESS:
+    case OP_GREATER:
+    case OP_LESS_EQUAL:
+    case OP_GREATER_EQUAL:
+        *pops = 2;
+        *pushes = 1;
+        break;
+    case OP_NEXT: // the iterator stays on the stack, results are only left when it doesn't jump
+        *pops = 1;
+        *pushes = 1 + instr[1];
+        break;
+    default:
+        break;
+    }
+}
+
+#define VERIFY(cond, msg)                                                                          \
+    if (!(cond)) {                                                                                 \
+        *err = msg;                                                                                \
+        return false;                                                                              \
+    }
+
+static bool isConstantType(CChunk *chunk, int indx, CObjType type)
+{
+    return indx < chunk->constants.count && isObjType(chunk->constants.values[indx], type);
+}
+
+// if the instruction at offset jumps, sets target to where it can jump to
+static bool jumpTarget(CChunk *chunk, int offset, int *target)
+{
+    int next = offset + instrSizeChunk(chunk, offset);
+
+    switch (genericOpcode(chunk->buf[offset])) {
+    case OP_JMP:
+    case OP_PEJMP:
+    case OP_EJMP:
+        *target = next + readu16Chunk(chunk, offset + 1);
+        return true;
+    case OP_JMPBACK:
+        *target = next - readu16Chunk(chunk, offset + 1);
+        return true;
+    case OP_NEXT:
+        *target = next + readu16Chunk(chunk, offset + 2);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// checks everything about the instruction at offset that doesn't depend on the stack
+static bool verifyInstr(CChunk *chunk, int offset, int upvals, const char **err)
+{
+    INSTRUCTION *instr = &chunk->buf[offset];
+    int avail = chunk->count - offset;
+
+    // quickened opcodes are only ever written by the VM
+    VERIFY(instr[0] <= OP_RETURN, "unknown opcode");
+
+    // CLOSURE's size depends on its constant, so that's checked before asking for the size
+    if (instr[0] == OP_CLOSURE) {
+        VERIFY(avail >= 3, "truncated instruction");
+        VERIFY(isConstantType(chunk, readu16Chunk(chunk, offset + 1), COBJ_FUNCTION),
+               "bad closure constant");
+    }
+
+    VERIFY(instrSizeChunk(chunk, offset) <= avail, "truncated instruction");
+
+    switch (instr[0]) {
+    case OP_LOADCONST:
+        VERIFY(readu16Chunk(chunk, offset + 1) < chunk->constants.count, "bad constant");
+        break;
+    case OP_GETGLOBAL:
+    case OP_SETGLOBAL:
+    case OP_GETOBJECT:
+    case OP_SETOBJECT:
+    case OP_GETMETHOD:
+        VERIFY(isConstantType(chunk, readu16Chunk(chunk, offset + 1), COBJ_STRING),
+               "bad identifier constant");
+        break;
+    case OP_INCGLOBAL:
+    case OP_INCOBJECT:
+        VERIFY(isConstantType(chunk, readu16Chunk(chunk, offset + 2), COBJ_STRING),
+               "bad identifier constant");
+        break;
+    case OP_INVOKE:
+        VERIFY(isConstantType(chunk, readu16Chunk(chunk, offset + 3), COBJ_STRING),
+               "bad identifier constant");
+        break;
+    case OP_GETUPVAL:
+    case OP_SETUPVAL:
+        VERIFY(instr[1] < upvals, "bad upvalue");
+        break;
+    case OP_INCUPVAL:
+        VERIFY(instr[2] < upvals, "bad upvalue");
+        break;
+    case OP_CLOSURE: {
+        CValue closure = chunk->constants.values[readu16Chunk(chunk, offset + 1)];
+        CObjFunction *func = cosmoV_readFunction(closure);
+
+        for (int i = 0; i < func->upvals; i++) {
+            INSTRUCTION encoding = instr[3 + i * 2];
+
+            if (encoding == OP_GETUPVAL) {
+                VERIFY(instr[4 + i * 2] < upvals, "bad captured upvalue");
+            } else {
+                VERIFY(encoding == OP_GETLOCAL, "bad capture");
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    return true;
+}
+
+// checks that the locals the instruction at offset uses are on the stack, depth is the stack depth
+// before it runs
+static bool verifyLocals(CChunk *chunk, int offset, int depth, const char **err)
+{
+    INSTRUCTION *instr = &chunk->buf[offset];
+
+    switch (instr[0]) {
+    case OP_GETLOCAL:
+        VERIFY(instr[1] < depth, "bad local");
+        break;
+    case OP_SETLOCAL: // the value is popped before it's set
+        VERIFY(instr[1] < depth - 1, "bad local");
+        break;
+    case OP_INCLOCAL:
+        VERIFY(instr[2] < depth, "bad local");
+        break;
+    case OP_CLOSURE: {
+        CValue closure = chunk->constants.values[readu16Chunk(chunk, offset + 1)];
+        CObjFunction *func = cosmoV_readFunction(closure);
+
+        // a recursive local function captures the slot the closure is about to be pushed to
+        for (int i = 0; i < func->upvals; i++) {
+            if (instr[3 + i * 2] == OP_GETLOCAL)
+                VERIFY(instr[4 + i * 2] <= depth, "bad captured local");
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    return true;
+}
+
+#undef VERIFY
+
+// walks every path through the chunk, if err isn't NULL the locals each instruction uses & the
+// stack depth reaching it are verified as well
+static int walkChunk(CState *state, CChunk *chunk, int depth, int *errOffset, const char **err)
+{
+    int count = chunk->count;
+    int *depths = cosmoM_xmalloc(state, sizeof(int) * count);
+    int *pending = cosmoM_xmalloc(state, sizeof(int) * count);
+    bool *queued = cosmoM_xmalloc(state, sizeof(bool) * count);
+    int pendingCount = 0, max = depth;
+
+    for (int i = 0; i < count; i++) {
+        depths[i] = -1;
+        queued[i] = false;
+    }
+
+    if (count > 0) {
+        depths[0] = depth;
+        queued[0] = true;
+        pending[pendingCount++] = 0;
+    } else if (err != NULL) {
+        *errOffset = 0;
+        *err = "empty chunk";
+        max = -1;
+    }
+
+    // an instruction is only revisited when the depth reaching it grows, so this always settles
+    // (or runs past STACK_MAX). verified chunks must reach an instruction with the same depth every
+    // time, so each instruction is only visited once
+    while (pendingCount > 0 && max >= 0) {
+        int offset = pending[--pendingCount];
+        int succ[2], succDepth[2], succCount = 0;
+        int next, pops, pushes, after;
+
+        *errOffset = offset;
+        if (err != NULL && !verifyLocals(chunk, offset, depths[offset], err)) {
+            max = -1;
+            break;
+        }
+
+        next = offset + instrSizeChunk(chunk, offset);
+        queued[offset] = false;
+        stackEffect(chunk, offset, &pops, &pushes);
+        if (depths[offset] < pops) {
+            if (err != NULL)
+                *err = "stack underflow";
+            max = -1;
+            break;
+        }
+
+        after = depths[offset] - pops + pushes;
+        if (after > max)
+            max = after;
+
+        switch (genericOpcode(chunk->buf[offset])) {
+        case OP_JMP:
+            succ[succCount] = next + readu16Chunk(chunk, offset + 1);
+            succDepth[succCount++] = after;
+            break;
+        case OP_JMPBACK:
+            succ[succCount] = next - readu16Chunk(chunk, offset + 1);
+            succDepth[succCount++] = after;
+            break;
+        case OP_PEJMP:
+        case OP_EJMP:
+            succ[succCount] = next + readu16Chunk(chunk, offset + 1);
+            succDepth[succCount++] = after;
+            succ[succCount] = next;
+            succDepth[succCount++] = after;
+            break;
+        case OP_NEXT: // exits the loop with just the iterator
+            succ[succCount] = next + readu16Chunk(chunk, offset + 2);
+            succDepth[succCount++] = depths[offset];
+            succ[succCount] = next;
+            succDepth[succCount++] = after;
+            break;
+        case OP_RETURN:
+            break;
+        default:
+            succ[succCount] = next;
+            succDepth[succCount++] = after;
+            break;
+        }
+
+        for (int i = 0; i < succCount; i++) {
+            if (succ[i] < 0 || succ[i] >= count || succDepth[i] > STACK_MAX) {
+                if (err != NULL)
+                    *err = "jump or stack out of bounds";
+                max = -1;
+                break;
+            }
+
+            if (err != NULL && depths[succ[i]] != -1 && depths[succ[i]] != succDepth[i]) {
+                *err = "mismatched stack depth";
+                max = -1;
+                break;
+            }
+
+            if (succDepth[i] > depths[succ[i]]) {
+                depths[succ[i]] = succDepth[i];
+                if (!queued[succ[i]]) {
+                    queued[succ[i]] = true;
+                    pending[pendingCount++] = succ[i];
+                }
+            }
+        }
+    }
+
+    cosmoM_freeArray(state, int, depths, count);
+    cosmoM_freeArray(state, int, pending, count);
+    cosmoM_freeArray(state, bool, queued, count);
+    return max;
+}
+
+int maxStackChunk(CState *state, CChunk *chunk, int depth)
+{
+    int errOffset;
+    return walkChunk(state, chunk, depth, &errOffset, NULL);
+}
+
+bool validateChunk(CState *state, CObjFunction *func)
+{
+    CChunk *chunk = &func->chunk;
+    bool *starts;
+    const char *err = NULL;
+    int errOffset = 0, offset = 0, target;
+
+    if (func->args < 0 || func->args > UINT8_MAX || func->upvals < 0 ||
+        func->upvals > UINT8_MAX + 1) {
+        cosmoV_error(state, "invalid bytecode: bad function header!");
+        return false;
+    }
+
+    // the disassembler & the jit decode the whole chunk, not just the reachable parts, so every
+    // instruction is checked & every jump has to land on one of them
+    starts = cosmoM_xmalloc(state, sizeof(bool) * chunk->count);
+    for (int i = 0; i < chunk->count; i++)
+        starts[i] = false;
+
+    for (; offset < chunk->count; offset += instrSizeChunk(chunk, offset)) {
+        if (!verifyInstr(chunk, offset, func->upvals, &err))
+            break;
+        starts[offset] = true;
+    }
+
+    if (err == NULL) {
+        for (offset = 0; offset < chunk->count; offset += instrSizeChunk(chunk, offset)) {
+            if (jumpTarget(chunk, offset, &target) &&
+                (target < 0 || target >= chunk->count || !starts[target])) {
+                err = "bad jump";
+                break;
+            }
+        }
+    }
+
+    cosmoM_freeArray(state, bool, starts, chunk->count);
+
+    if (err == NULL) {
+        func->maxStack = walkChunk(state, chunk, 1 + func->args + func->variadic, &errOffset, &err);
+    } else {
+        errOffset = offset;
+        func->maxStack = -1;
+    }
+
+    if (func->maxStack < 0) {
+        cosmoV_error(state, "invalid bytecode: %s at %d!", err, errOffset);
+        return false;
+    }
+
+    return true;
+}
@@ -5,6 +5,24 @@
 #include "cosmo.h"
 #include "cvalue.h"
 
+// a pre-decoded chunk has one of these for every byte of code, see VM_THREADED in cvm.h
+typedef union CThreadedSlot
+{
+    const void *handler; // for an opcode, the address of the code that runs it
+    struct
+    {
+        uint16_t u16; // the u16 starting at this byte (if there is one)
+        uint8_t u8;
+    } operand;
+} CThreadedSlot;
+
+// every byte from offset up to the next CLineInfo's offset was compiled from line
+typedef struct CLineInfo
+{
+    int offset;
+    int line;
+} CLineInfo;
+
 struct CChunk
 {
     size_t capacity;       // the amount of space we've allocated for
@@ -12,7 +30,8 @@ struct CChunk
     INSTRUCTION *buf;      // whole chunk
     CValueArray constants; // holds constants
     size_t lineCapacity;
-    int *lineInfo;
+    size_t lineCount;
+    CLineInfo *lineInfo; // sorted by offset, empty if the line info was stripped
 };
 
 CChunk *newChunk(CState *state, size_t startCapacity);
@@ -21,12 +40,28 @@ void cleanChunk(CState *state, CChunk *chunk); // frees everything but the struc
 void freeChunk(CState *state, CChunk *chunk);  // frees everything including the struct
 int addConstant(CState *state, CChunk *chunk, CValue value);
 
-bool validateChunk(CState *state, CChunk *chunk);
+/*
+    verifies every instruction reachable in the function's chunk: opcodes, constant/local/upvalue
+    indices & jump targets are all in bounds, and the stack depth is the same along every path to an
+    instruction. the VM doesn't check any of this at runtime! sets func->maxStack, or throws an
+    error & returns false if the chunk isn't safe to run
+*/
+bool validateChunk(CState *state, CObjFunction *func);
 
 // write to chunk
 void writeu8Chunk(CState *state, CChunk *chunk, INSTRUCTION i, int line);
 void writeu16Chunk(CState *state, CChunk *chunk, uint16_t i, int line);
 
+// returns the line the byte at offset was compiled from, or 0 if the chunk has no line info
+int getLineChunk(CChunk *chunk, int offset);
+
+// returns the size of the instruction at offset, including the opcode & its operands
+int instrSizeChunk(CChunk *chunk, int offset);
+
+// walks every path through the chunk starting with depth values on the stack, returns the most
+// values the stack ever holds or -1 if an instruction would pop more values than there are
+int maxStackChunk(CState *state, CChunk *chunk, int depth);
+
 // read from chunk
 static inline INSTRUCTION readu8Chunk(CChunk *chunk, int offset)
 {
@@ -86,9 +86,9 @@ int disasmInstr(CChunk *chunk, int offset, int indent)
     printf("%04d ", offset);
 
     INSTRUCTION i = chunk->buf[offset];
-    int line = chunk->lineInfo[offset];
+    int line = getLineChunk(chunk, offset);
 
-    if (offset > 0 && line == chunk->lineInfo[offset - 1]) {
+    if (offset > 0 && line == getLineChunk(chunk, offset - 1)) {
         printf("   | ");
     } else {
         printf("%4d ", line);
@@ -180,6 +180,20 @@ int disasmInstr(CChunk *chunk, int offset, int indent)
         return simpleInstruction("OP_MOD", offset);
     case OP_POW:
         return simpleInstruction("OP_POW", offset);
+    case OP_IDIV:
+        return simpleInstruction("OP_IDIV", offset);
+    case OP_BAND:
+        return simpleInstruction("OP_BAND", offset);
+    case OP_BOR:
+        return simpleInstruction("OP_BOR", offset);
+    case OP_BXOR:
+        return simpleInstruction("OP_BXOR", offset);
+    case OP_SHL:
+        return simpleInstruction("OP_SHL", offset);
+    case OP_SHR:
+        return simpleInstruction("OP_SHR", offset);
+    case OP_BNOT:
+        return simpleInstruction("OP_BNOT", offset);
     case OP_TRUE:
         return simpleInstruction("OP_TRUE", offset);
     case OP_FALSE:
@@ -216,6 +230,40 @@ int disasmInstr(CChunk *chunk, int offset, int indent)
         return u8u16OperandInstruction("OP_INCOBJECT", chunk, offset);
     case OP_RETURN:
         return u8OperandInstruction("OP_RETURN", chunk, offset);
+    case OP_ADD_INT:
+        return simpleInstruction("OP_ADD_INT", offset);
+    case OP_SUB_INT:
+        return simpleInstruction("OP_SUB_INT", offset);
+    case OP_MULT_INT:
+        return simpleInstruction("OP_MULT_INT", offset);
+    case OP_DIV_INT:
+        return simpleInstruction("OP_DIV_INT", offset);
+    case OP_LESS_INT:
+        return simpleInstruction("OP_LESS_INT", offset);
+    case OP_GREATER_INT:
+        return simpleInstruction("OP_GREATER_INT", offset);
+    case OP_LESS_EQUAL_INT:
+        return simpleInstruction("OP_LESS_EQUAL_INT", offset);
+    case OP_GREATER_EQUAL_INT:
+        return simpleInstruction("OP_GREATER_EQUAL_INT", offset);
+    case OP_ADD_FLOAT:
+        return simpleInstruction("OP_ADD_FLOAT", offset);
+    case OP_SUB_FLOAT:
+        return simpleInstruction("OP_SUB_FLOAT", offset);
+    case OP_MULT_FLOAT:
+        return simpleInstruction("OP_MULT_FLOAT", offset);
+    case OP_DIV_FLOAT:
+        return simpleInstruction("OP_DIV_FLOAT", offset);
+    case OP_LESS_FLOAT:
+        return simpleInstruction("OP_LESS_FLOAT", offset);
+    case OP_GREATER_FLOAT:
+        return simpleInstruction("OP_GREATER_FLOAT", offset);
+    case OP_LESS_EQUAL_FLOAT:
+        return simpleInstruction("OP_LESS_EQUAL_FLOAT", offset);
+    case OP_GREATER_EQUAL_FLOAT:
+        return simpleInstruction("OP_GREATER_EQUAL_FLOAT", offset);
+    case OP_INDEX_TBL:
+        return simpleInstruction("OP_INDEX_TBL", offset);
     default:
         printf("Unknown opcode! [%d]\n", i);
         return 1;
@@ -12,6 +12,7 @@ typedef struct
     const void *userData;
     cosmo_Writer writer;
     int writerStatus;
+    bool strip;
 } DumpState;
 
 static bool writeCValue(DumpState *dstate, CValue val);
@@ -22,16 +23,21 @@ static bool writeCValue(DumpState *dstate, CValue val);
     }
 
 static void initDumpState(CState *state, DumpState *dstate, cosmo_Writer writer,
-                          const void *userData)
+                          const void *userData, bool strip)
 {
     dstate->state = state;
     dstate->userData = userData;
     dstate->writer = writer;
     dstate->writerStatus = 0;
+    dstate->strip = strip;
 }
 
 static bool writeBlock(DumpState *dstate, const void *data, size_t size)
 {
+    /* empty strings & vectors have nothing to write */
+    if (size == 0)
+        return dstate->writerStatus == 0;
+
     if (dstate->writerStatus == 0) {
         dstate->writerStatus = dstate->writer(dstate->state, data, size, dstate->userData);
     }
@@ -100,11 +106,20 @@ static bool writeCObjFunction(DumpState *dstate, CObjFunction *obj)
     check(writeu32(dstate, obj->upvals));
     check(writeu8(dstate, obj->variadic));
 
-    /* write chunk info */
-    check(writeVector(dstate, obj->chunk.buf, sizeof(uint8_t), obj->chunk.count));
+    /* write chunk info, quickened instructions are written back as their generic opcode */
+    check(writeSize(dstate, obj->chunk.count));
+    for (size_t i = 0; i < obj->chunk.count;) {
+        int size = instrSizeChunk(&obj->chunk, i);
+
+        check(writeu8(dstate, genericOpcode(obj->chunk.buf[i])));
+        if (size > 1)
+            check(writeBlock(dstate, &obj->chunk.buf[i + 1], size - 1));
+        i += size;
+    }
 
-    /* write line info */
-    check(writeVector(dstate, obj->chunk.lineInfo, sizeof(int), obj->chunk.count));
+    /* write line info, a stripped dump just has no runs */
+    check(writeVector(dstate, obj->chunk.lineInfo, sizeof(CLineInfo),
+                      dstate->strip ? 0 : obj->chunk.lineCount));
 
     /* write constants */
     check(writeSize(dstate, obj->chunk.constants.count));
@@ -163,7 +178,9 @@ static bool writeCValue(DumpState *dstate, CValue val)
     /* write value payload/body */
     switch (t) {
     case COSMO_TNUMBER:
-        WRITE_VAR(dstate, cosmo_Number, cosmoV_readNumber(val))
+        WRITE_VAR(dstate, cosmo_Number, cosmoV_readFloat(val))
+    case COSMO_TINTEGER:
+        WRITE_VAR(dstate, cosmo_Integer, cosmoV_readInteger(val))
     case COSMO_TBOOLEAN:
         WRITE_VAR(dstate, bool, cosmoV_readBoolean(val))
     case COSMO_TREF:
@@ -192,10 +209,11 @@ bool cosmoD_isBigEndian()
     return _indxint.c[0] == 0xDE;
 }
 
-int cosmoD_dump(CState *state, CObjFunction *func, cosmo_Writer writer, const void *userData)
+int cosmoD_dump(CState *state, CObjFunction *func, cosmo_Writer writer, const void *userData,
+                bool strip)
 {
     DumpState dstate;
-    initDumpState(state, &dstate, writer, userData);
+    initDumpState(state, &dstate, writer, userData, strip);
 
     check(writeHeader(&dstate));
     check(writeCObjFunction(&dstate, func));
@@ -6,12 +6,13 @@
 
 #include <stdio.h>
 
-#define COSMO_MAGIC     "COS\x12"
+#define COSMO_MAGIC     "COS\x15"
 #define COSMO_MAGIC_LEN 4
 
 bool cosmoD_isBigEndian();
 
-/* returns non-zero on error */
-int cosmoD_dump(CState *state, CObjFunction *func, cosmo_Writer writer, const void *userData);
+/* if strip is true, line info is left out of the dump. returns non-zero on error */
+int cosmoD_dump(CState *state, CObjFunction *func, cosmo_Writer writer, const void *userData,
+                bool strip);
 
 #endif
\ No newline at end of file
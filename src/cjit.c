@@ -0,0 +1,1113 @@
+#include "cjit.h"
+
+#ifdef COSMO_JIT
+
+#    include "cchunk.h"
+#    include "coperators.h"
+#    include "cstate.h"
+#    include "cvm.h"
+
+#    include <string.h>
+#    include <sys/mman.h>
+#    include <unistd.h>
+
+/*
+    baseline template JIT for x86-64. every instruction of the chunk is translated in order to a
+    fixed template: pushes, pops, locals & jumps are emitted inline, opcodes with an existing C
+    entrypoint (cosmoV_call, cosmoV_concat, etc.) call it directly and everything else calls
+    cosmoV_step, which runs the very same opcode body the interpreter uses. there's no register
+    allocation or type specialization, this just gets rid of the dispatch overhead.
+
+    while native code is running, rbx holds the state, r12 the callframe, r13 the stack top & r14
+    the frame's base. state->top & frame->pc are written back before calling into C so the GC,
+    errors & backtraces all still work
+*/
+
+typedef enum
+{
+    RAX,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15
+} JitReg;
+
+typedef struct
+{
+    size_t at;  // offset of the rel32 to patch
+    int target; // bytecode offset being jumped to
+} JitPatch;
+
+typedef struct
+{
+    uint8_t *code;
+    size_t count;
+    size_t capacity;
+    JitPatch *patches;
+    int patchCount;
+    int patchCapacity;
+    int *labels; // native offset of each bytecode offset, -1 if not the start of an instruction
+    bool trace;  // failed guards exit back to the interpreter instead of stepping
+} JitState;
+
+/*
+    loops are traced once their back-edge has been taken COSMOJ_HOTLOOP times. the interpreter
+    records one iteration through cosmoV_step, noting the types it saw & which way each branch
+    went, then that linear path is compiled with guards. anything that strays from the recorded
+    path exits back to cosmoV_execute with frame->pc pointing at where to pick back up
+*/
+typedef struct CJitTrace
+{
+    struct CJitTrace *next;
+    CosmoNative code; // NULL until the loop is compiled
+    void *mem;        // executable memory backing code
+    int header;       // bytecode offset of the loop header
+    int hits;         // back-edges taken since the last recording
+    int aborts;       // failed recordings, the loop is never traced again after TRACE_MAXABORTS
+} CJitTrace;
+
+#    define TRACE_MAX       512 // max # of instructions in a trace
+#    define TRACE_MAXABORTS 4
+
+#    define TRACE_NUMBERS   (1 << 0) // operands were numbers while recording
+#    define TRACE_TAKEN     (1 << 1) // the branch was taken while recording
+
+typedef struct
+{
+    int offset;
+    uint8_t flags;
+} TraceEntry;
+
+#    define TOP      ((int32_t)offsetof(CState, top))
+#    define FRAME_PC ((int32_t)offsetof(CCallFrame, pc))
+#    define BASE     ((int32_t)offsetof(CCallFrame, base))
+#    define VALSIZE  ((int32_t)sizeof(CValue))
+
+// offset of the double (or integer) inside a CValue
+#    ifdef NAN_BOXXED
+#        define NUMOFF 0
+#    else
+#        define NUMOFF ((int32_t)offsetof(CValue, val))
+#    endif
+
+// condition codes for jcc
+#    define CC_O     0x80
+#    define CC_B     0x82
+#    define CC_AE    0x83
+#    define CC_E     0x84
+#    define CC_NE    0x85
+#    define CC_BE    0x86
+#    define CC_L     0x8C
+#    define CC_LE    0x8E
+
+// pushed by OP_TRUE, OP_FALSE & OP_NIL
+static CValue jitTrue, jitFalse, jitNil;
+
+static void emitByte(JitState *J, uint8_t byte)
+{
+    if (J->count >= J->capacity) {
+        J->capacity = J->capacity == 0 ? 256 : J->capacity * 2;
+        J->code = realloc(J->code, J->capacity);
+    }
+
+    J->code[J->count++] = byte;
+}
+
+static void emitU32(JitState *J, uint32_t num)
+{
+    for (int i = 0; i < 4; i++)
+        emitByte(J, (num >> (i * 8)) & 0xFF);
+}
+
+static void emitU64(JitState *J, uint64_t num)
+{
+    emitU32(J, num & 0xFFFFFFFF);
+    emitU32(J, num >> 32);
+}
+
+static void emitRex(JitState *J, bool wide, int reg, int rm)
+{
+    uint8_t rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | (rm >> 3);
+
+    if (rex != 0x40)
+        emitByte(J, rex);
+}
+
+// [base + disp32] operand, rsp & r12 need a SIB byte
+static void emitModRM(JitState *J, int reg, int base, int32_t disp)
+{
+    emitByte(J, 0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == RSP)
+        emitByte(J, 0x24);
+    emitU32(J, disp);
+}
+
+// mov dst, [base + disp]
+static void emitLoad(JitState *J, JitReg dst, JitReg base, int32_t disp)
+{
+    emitRex(J, true, dst, base);
+    emitByte(J, 0x8B);
+    emitModRM(J, dst, base, disp);
+}
+
+// mov [base + disp], src
+static void emitStore(JitState *J, JitReg base, int32_t disp, JitReg src)
+{
+    emitRex(J, true, src, base);
+    emitByte(J, 0x89);
+    emitModRM(J, src, base, disp);
+}
+
+// mov dst, imm64
+static void emitMovImm(JitState *J, JitReg dst, uint64_t imm)
+{
+    emitRex(J, true, 0, dst);
+    emitByte(J, 0xB8 + (dst & 7));
+    emitU64(J, imm);
+}
+
+// mov dst32, imm32 (zero extended)
+static void emitMovImm32(JitState *J, JitReg dst, uint32_t imm)
+{
+    emitRex(J, false, 0, dst);
+    emitByte(J, 0xB8 + (dst & 7));
+    emitU32(J, imm);
+}
+
+// mov dst, src
+static void emitMovReg(JitState *J, JitReg dst, JitReg src)
+{
+    emitRex(J, true, src, dst);
+    emitByte(J, 0x89);
+    emitByte(J, 0xC0 | ((src & 7) << 3) | (dst & 7));
+}
+
+// add dst, imm32 (negative to subtract)
+static void emitAddImm(JitState *J, JitReg dst, int32_t imm)
+{
+    emitRex(J, true, 0, dst);
+    emitByte(J, 0x81);
+    emitByte(J, 0xC0 | (dst & 7));
+    emitU32(J, (uint32_t)imm);
+}
+
+#    ifdef NAN_BOXXED
+// shl (ext 4), shr (ext 5) or sar (ext 7) reg, amount
+static void emitShift(JitState *J, uint8_t ext, JitReg reg, uint8_t amount)
+{
+    emitRex(J, true, 0, reg);
+    emitByte(J, 0xC1);
+    emitByte(J, 0xC0 | (ext << 3) | (reg & 7));
+    emitByte(J, amount);
+}
+#    endif
+
+static void emitPush(JitState *J, JitReg reg)
+{
+    emitRex(J, false, 0, reg);
+    emitByte(J, 0x50 + (reg & 7));
+}
+
+static void emitPop(JitState *J, JitReg reg)
+{
+    emitRex(J, false, 0, reg);
+    emitByte(J, 0x58 + (reg & 7));
+}
+
+// copies a CValue from [src + srcDisp] to [dst + dstDisp] 8 bytes at a time, clobbers rdx. (a
+// 16 byte copy would stall the 8 byte loads of the number that usually follow it)
+static void emitCopyValue(JitState *J, JitReg dst, int32_t dstDisp, JitReg src, int32_t srcDisp)
+{
+    for (int32_t i = 0; i < VALSIZE; i += 8) {
+        emitLoad(J, RDX, src, srcDisp + i);
+        emitStore(J, dst, dstDisp + i, RDX);
+    }
+}
+
+// state->top lives in r13 while in native code, so it's synced around every call
+static void emitCall(JitState *J, void *fn)
+{
+    emitStore(J, RBX, TOP, R13);
+    emitMovImm(J, RAX, (uint64_t)(uintptr_t)fn);
+    emitByte(J, 0xFF); // call rax
+    emitByte(J, 0xD0);
+    emitLoad(J, R13, RBX, TOP);
+}
+
+// jmp (cond == 0) or jcc rel32 to the bytecode offset target, patched once every label is known
+static void emitJump(JitState *J, uint8_t cond, int target)
+{
+    if (cond == 0) {
+        emitByte(J, 0xE9);
+    } else {
+        emitByte(J, 0x0F);
+        emitByte(J, cond);
+    }
+
+    if (J->patchCount >= J->patchCapacity) {
+        J->patchCapacity = J->patchCapacity == 0 ? 16 : J->patchCapacity * 2;
+        J->patches = realloc(J->patches, sizeof(JitPatch) * J->patchCapacity);
+    }
+
+    J->patches[J->patchCount].at = J->count;
+    J->patches[J->patchCount++].target = target;
+    emitU32(J, 0);
+}
+
+// jmp/jcc rel32 to a native offset that isn't known yet, returns where to patch it
+static size_t emitJumpForward(JitState *J, uint8_t cond)
+{
+    if (cond == 0) {
+        emitByte(J, 0xE9);
+    } else {
+        emitByte(J, 0x0F);
+        emitByte(J, cond);
+    }
+
+    emitU32(J, 0);
+    return J->count - 4;
+}
+
+// points a jump from emitJumpForward at the current offset
+static void patchHere(JitState *J, size_t at)
+{
+    int32_t rel = (int32_t)(J->count - (at + 4));
+    memcpy(&J->code[at], &rel, sizeof(int32_t));
+}
+
+// scalar double op (movsd, addsd, ucomisd, etc.) between xmm0 and [base + disp]
+static void emitSSE(JitState *J, uint8_t prefix, uint8_t op, JitReg base, int32_t disp)
+{
+    emitByte(J, prefix);
+    emitRex(J, false, 0, base);
+    emitByte(J, 0x0F);
+    emitByte(J, op);
+    emitModRM(J, 0, base, disp);
+}
+
+#    define emitMovsdLoad(J, base, disp)  emitSSE(J, 0xF2, 0x10, base, disp)
+#    define emitMovsdStore(J, base, disp) emitSSE(J, 0xF2, 0x11, base, disp)
+#    define emitUcomisd(J, base, disp)    emitSSE(J, 0x66, 0x2E, base, disp)
+
+// jumps to the returned patch if the CValue at [base + disp] isn't a double, clobbers rcx/rdx
+static size_t emitCheckFloat(JitState *J, JitReg base, int32_t disp)
+{
+#    ifdef NAN_BOXXED
+    // every double is below INT_SIG
+    emitLoad(J, RDX, base, disp);
+    emitMovImm(J, RCX, INT_SIG);
+    emitByte(J, 0x48); // cmp rdx, rcx
+    emitByte(J, 0x39);
+    emitByte(J, 0xCA);
+    return emitJumpForward(J, CC_AE);
+#    else
+    // cmp dword [base + disp], COSMO_TNUMBER
+    emitRex(J, false, 0, base);
+    emitByte(J, 0x81);
+    emitModRM(J, 7, base, disp + (int32_t)offsetof(CValue, type));
+    emitU32(J, COSMO_TNUMBER);
+    return emitJumpForward(J, CC_NE);
+#    endif
+}
+
+// jumps to the returned patch if the CValue at [base + disp] isn't an integer, clobbers rdx
+static size_t emitCheckInteger(JitState *J, JitReg base, int32_t disp)
+{
+#    ifdef NAN_BOXXED
+    emitLoad(J, RDX, base, disp);
+    emitShift(J, 5, RDX, 48);
+    emitByte(J, 0x81); // cmp edx, INT_SIG >> 48
+    emitByte(J, 0xFA);
+    emitU32(J, (uint32_t)(INT_SIG >> 48));
+    return emitJumpForward(J, CC_NE);
+#    else
+    // cmp dword [base + disp], COSMO_TINTEGER
+    emitRex(J, false, 0, base);
+    emitByte(J, 0x81);
+    emitModRM(J, 7, base, disp + (int32_t)offsetof(CValue, type));
+    emitU32(J, COSMO_TINTEGER);
+    return emitJumpForward(J, CC_NE);
+#    endif
+}
+
+// dst = the integer in the CValue at [base + disp]
+static void emitLoadInteger(JitState *J, JitReg dst, JitReg base, int32_t disp)
+{
+    emitLoad(J, dst, base, disp + NUMOFF);
+#    ifdef NAN_BOXXED
+    emitShift(J, 4, dst, 16); // sign extend the 48 bit payload
+    emitShift(J, 7, dst, 16);
+#    endif
+}
+
+// jumps to the returned patch if the integer in rax doesn't fit in a payload (so it'd need
+// promoting to a double), clobbers rdx. returns 0 if every int64_t fits
+static size_t emitCheckIntegerRange(JitState *J)
+{
+#    ifdef NAN_BOXXED
+    emitMovReg(J, RDX, RAX);
+    emitShift(J, 4, RDX, 16);
+    emitShift(J, 7, RDX, 16);
+    emitByte(J, 0x48); // cmp rdx, rax
+    emitByte(J, 0x39);
+    emitByte(J, 0xC2);
+    return emitJumpForward(J, CC_NE);
+#    else
+    return 0;
+#    endif
+}
+
+// stores the integer in rax over the integer CValue at [base + disp], clobbers rcx
+static void emitStoreInteger(JitState *J, JitReg base, int32_t disp)
+{
+#    ifdef NAN_BOXXED
+    emitShift(J, 4, RAX, 16); // rax = payload | INT_SIG
+    emitShift(J, 5, RAX, 16);
+    emitMovImm(J, RCX, INT_SIG);
+    emitByte(J, 0x48); // or rax, rcx
+    emitByte(J, 0x09);
+    emitByte(J, 0xC8);
+#    endif
+    emitStore(J, base, disp + NUMOFF, RAX);
+}
+
+static void emitPrologue(JitState *J)
+{
+    emitPush(J, RBP);
+    emitMovReg(J, RBP, RSP);
+    emitPush(J, RBX);
+    emitPush(J, R12);
+    emitPush(J, R13);
+    emitPush(J, R14);
+
+    emitMovReg(J, RBX, RDI);     // state
+    emitMovReg(J, R12, RSI);     // frame
+    emitLoad(J, R13, RBX, TOP);  // state->top
+    emitLoad(J, R14, R12, BASE); // frame->base
+}
+
+// expects the result count to already be in eax
+static void emitEpilogue(JitState *J)
+{
+    emitStore(J, RBX, TOP, R13);
+    emitPop(J, R14);
+    emitPop(J, R13);
+    emitPop(J, R12);
+    emitPop(J, RBX);
+    emitPop(J, RBP);
+    emitByte(J, 0xC3); // ret
+}
+
+static void emitSetPC(JitState *J, INSTRUCTION *pc)
+{
+    emitMovImm(J, RAX, (uint64_t)(uintptr_t)pc);
+    emitStore(J, R12, FRAME_PC, RAX);
+}
+
+// leaves the trace, the interpreter continues from pc
+static void emitExit(JitState *J, INSTRUCTION *pc)
+{
+    emitSetPC(J, pc);
+    emitMovImm32(J, RAX, 0);
+    emitEpilogue(J);
+}
+
+// cmp frame->pc, pc
+static void emitComparePC(JitState *J, INSTRUCTION *pc)
+{
+    emitLoad(J, RAX, R12, FRAME_PC);
+    emitMovImm(J, RCX, (uint64_t)(uintptr_t)pc);
+    emitByte(J, 0x48); // cmp rax, rcx
+    emitByte(J, 0x39);
+    emitByte(J, 0xC8);
+}
+
+// pushes the CValue at [src + disp]
+static void emitPushValue(JitState *J, JitReg src, int32_t disp)
+{
+    emitCopyValue(J, R13, 0, src, disp);
+    emitAddImm(J, R13, VALSIZE);
+}
+
+static void emitPushConst(JitState *J, CValue *val)
+{
+    emitMovImm(J, RCX, (uint64_t)(uintptr_t)val);
+    emitPushValue(J, RCX, 0);
+}
+
+// runs the instruction at offset through cosmoV_step
+static void emitStep(JitState *J, CChunk *chunk, int offset)
+{
+    emitSetPC(J, &chunk->buf[offset]);
+    emitMovReg(J, RDI, RBX);
+    emitCall(J, (void *)cosmoV_step);
+}
+
+// if the last helper moved frame->pc anywhere other than next, it took the branch to target
+static void emitBranchIfJumped(JitState *J, CChunk *chunk, int next, int target)
+{
+    emitComparePC(J, &chunk->buf[next]);
+    emitJump(J, CC_NE, target);
+}
+
+// exits the trace if the branch that was just stepped didn't go where it went while recording
+static void emitGuardPC(JitState *J, INSTRUCTION *expected)
+{
+    size_t stay;
+
+    emitComparePC(J, expected);
+    stay = emitJumpForward(J, CC_E);
+    emitMovImm32(J, RAX, 0); // frame->pc already points at the other path
+    emitEpilogue(J);
+    patchHere(J, stay);
+}
+
+// what a failed type guard does: baseline code steps the instruction, traces exit at it
+static void emitSlowPath(JitState *J, CChunk *chunk, int offset)
+{
+    if (J->trace) {
+        emitExit(J, &chunk->buf[offset]);
+    } else {
+        emitStep(J, chunk, offset);
+    }
+}
+
+// points every non-zero patch at the current offset
+static void patchAllHere(JitState *J, size_t *patches, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (patches[i] != 0)
+            patchHere(J, patches[i]);
+    }
+}
+
+/*
+    ADD, SUB, MULT & DIV on two doubles are done inline, as are ADD, SUB & MULT on two integers.
+    anything else (including integer overflow, which promotes to a double) goes through cosmoV_step
+*/
+static void emitArith(JitState *J, CChunk *chunk, int offset, uint8_t sseOp)
+{
+    INSTRUCTION op = genericOpcode(chunk->buf[offset]);
+    size_t notFloat, slow[5] = {0}, done[2] = {0};
+
+    notFloat = emitCheckFloat(J, R13, -2 * VALSIZE);
+    slow[0] = emitCheckFloat(J, R13, -VALSIZE);
+    emitMovsdLoad(J, R13, -2 * VALSIZE + NUMOFF);
+    emitSSE(J, 0xF2, sseOp, R13, -VALSIZE + NUMOFF);
+    emitMovsdStore(J, R13, -2 * VALSIZE + NUMOFF); // the result replaces valA
+    emitAddImm(J, R13, -VALSIZE);
+    done[0] = emitJumpForward(J, 0);
+
+    if (op == OP_DIV) {
+        slow[1] = notFloat; // dividing integers makes a double, cosmoV_step handles it
+    } else {
+        patchHere(J, notFloat);
+        slow[1] = emitCheckInteger(J, R13, -2 * VALSIZE);
+        slow[2] = emitCheckInteger(J, R13, -VALSIZE);
+        emitLoadInteger(J, RAX, R13, -2 * VALSIZE);
+        emitLoadInteger(J, RCX, R13, -VALSIZE);
+        emitByte(J, 0x48);
+        switch (op) {
+        case OP_ADD: // add rax, rcx
+            emitByte(J, 0x01);
+            emitByte(J, 0xC8);
+            break;
+        case OP_SUB: // sub rax, rcx
+            emitByte(J, 0x29);
+            emitByte(J, 0xC8);
+            break;
+        default: // imul rax, rcx
+            emitByte(J, 0x0F);
+            emitByte(J, 0xAF);
+            emitByte(J, 0xC1);
+            break;
+        }
+        slow[3] = emitJumpForward(J, CC_O);
+        slow[4] = emitCheckIntegerRange(J);
+        emitStoreInteger(J, R13, -2 * VALSIZE);
+        emitAddImm(J, R13, -VALSIZE);
+        done[1] = emitJumpForward(J, 0);
+    }
+
+    patchAllHere(J, slow, 5);
+    emitSlowPath(J, chunk, offset);
+    patchAllHere(J, done, 2);
+}
+
+// pops both operands of an already emitted cmp/ucomisd & jumps on falseCond, returns a patch to
+// the end of emitCompareJump in a trace, else 0
+static size_t emitCompareBranch(JitState *J, CChunk *chunk, uint8_t falseCond, int next,
+                                int target, bool taken)
+{
+    size_t stay;
+
+    // lea r13, [r13 - 2 * VALSIZE], unlike add this leaves the flags alone
+    emitRex(J, true, R13, R13);
+    emitByte(J, 0x8D);
+    emitModRM(J, R13, R13, -2 * VALSIZE);
+
+    if (J->trace) {
+        stay = emitJumpForward(J, taken ? falseCond : falseCond ^ 1); // jcc ^ 1 inverts it
+        emitExit(J, &chunk->buf[taken ? next : target]);
+        patchHere(J, stay);
+        return emitJumpForward(J, 0);
+    }
+
+    emitJump(J, falseCond, target);
+    emitJump(J, 0, next);
+    return 0;
+}
+
+/*
+    a comparison immediately followed by an OP_PEJMP is fused into a compare & branch, so the
+    boolean never hits the stack. ucomisd sets CF & ZF on unordered operands, so the comparison is
+    arranged so that NaNs always take the 'false' branch. two integers are compared with the signed
+    version of the same condition. the slow path steps the comparison & falls through into the
+    OP_PEJMP's own template.
+
+    in a trace only the recorded direction (taken is true if it jumped to target) stays native
+*/
+static void emitCompareJump(JitState *J, CChunk *chunk, int offset, int next, int target,
+                            bool taken)
+{
+    INSTRUCTION op = genericOpcode(chunk->buf[offset]);
+    bool swap = op == OP_LESS || op == OP_LESS_EQUAL; // compare b to a instead
+    uint8_t falseCond = (op == OP_LESS || op == OP_GREATER) ? CC_BE : CC_B;
+    size_t notFloat, slow[3], done[2];
+
+    notFloat = emitCheckFloat(J, R13, -2 * VALSIZE);
+    slow[0] = emitCheckFloat(J, R13, -VALSIZE);
+    emitMovsdLoad(J, R13, (swap ? -VALSIZE : -2 * VALSIZE) + NUMOFF);
+    emitUcomisd(J, R13, (swap ? -2 * VALSIZE : -VALSIZE) + NUMOFF);
+    done[0] = emitCompareBranch(J, chunk, falseCond, next, target, taken);
+
+    patchHere(J, notFloat);
+    slow[1] = emitCheckInteger(J, R13, -2 * VALSIZE);
+    slow[2] = emitCheckInteger(J, R13, -VALSIZE);
+    emitLoadInteger(J, RAX, R13, swap ? -VALSIZE : -2 * VALSIZE);
+    emitLoadInteger(J, RCX, R13, swap ? -2 * VALSIZE : -VALSIZE);
+    emitByte(J, 0x48); // cmp rax, rcx
+    emitByte(J, 0x39);
+    emitByte(J, 0xC8);
+    done[1] = emitCompareBranch(J, chunk, falseCond == CC_BE ? CC_LE : CC_L, next, target, taken);
+
+    patchAllHere(J, slow, 3);
+    emitSlowPath(J, chunk, offset);
+    patchAllHere(J, done, 2);
+}
+
+// OP_INCLOCAL on a number local
+static void emitIncLocal(JitState *J, CChunk *chunk, int offset)
+{
+    int32_t local = chunk->buf[offset + 2] * VALSIZE;
+    int8_t inc = (int8_t)(chunk->buf[offset + 1] - 128);
+    double incFloat = inc;
+    uint64_t incBits;
+    size_t notFloat, slow[3], done[2];
+
+    memcpy(&incBits, &incFloat, sizeof(double));
+
+    notFloat = emitCheckFloat(J, R14, local);
+    emitPushValue(J, R14, local); // pushes the old value
+    emitMovsdLoad(J, R14, local + NUMOFF);
+    emitMovImm(J, RCX, incBits);
+    emitByte(J, 0x66); // movq xmm1, rcx
+    emitByte(J, 0x48);
+    emitByte(J, 0x0F);
+    emitByte(J, 0x6E);
+    emitByte(J, 0xC9);
+    emitByte(J, 0xF2); // addsd xmm0, xmm1
+    emitByte(J, 0x0F);
+    emitByte(J, 0x58);
+    emitByte(J, 0xC1);
+    emitMovsdStore(J, R14, local + NUMOFF);
+    done[0] = emitJumpForward(J, 0);
+
+    // the integer is only written back once it's known not to overflow
+    patchHere(J, notFloat);
+    slow[0] = emitCheckInteger(J, R14, local);
+    emitLoadInteger(J, RAX, R14, local);
+    emitAddImm(J, RAX, inc);
+    slow[1] = emitJumpForward(J, CC_O);
+    slow[2] = emitCheckIntegerRange(J);
+    emitPushValue(J, R14, local);
+    emitStoreInteger(J, R14, local);
+    done[1] = emitJumpForward(J, 0);
+
+    patchAllHere(J, slow, 3);
+    emitSlowPath(J, chunk, offset);
+    patchAllHere(J, done, 2);
+}
+
+static uint16_t readUInt(CChunk *chunk, int offset)
+{
+    uint16_t num;
+    memcpy(&num, &chunk->buf[offset], sizeof(uint16_t));
+    return num;
+}
+
+static void emitInstruction(JitState *J, CObjFunction *func, int offset, int size)
+{
+    CChunk *chunk = &func->chunk;
+    int next = offset + size;
+
+    switch (genericOpcode(chunk->buf[offset])) {
+    // pushes are never checked, pushCallFrame already made room for maxStack slots
+    case OP_LOADCONST:
+        emitPushConst(J, &chunk->constants.values[readUInt(chunk, offset + 1)]);
+        break;
+    case OP_GETLOCAL:
+        emitPushValue(J, R14, chunk->buf[offset + 1] * VALSIZE);
+        break;
+    case OP_TRUE:
+        emitPushConst(J, &jitTrue);
+        break;
+    case OP_FALSE:
+        emitPushConst(J, &jitFalse);
+        break;
+    case OP_NIL:
+        emitPushConst(J, &jitNil);
+        break;
+    case OP_INCLOCAL:
+        emitIncLocal(J, chunk, offset);
+        break;
+    case OP_SETLOCAL:
+        emitAddImm(J, R13, -VALSIZE);
+        emitCopyValue(J, R14, chunk->buf[offset + 1] * VALSIZE, R13, 0);
+        break;
+    case OP_POP:
+        emitAddImm(J, R13, -(chunk->buf[offset + 1] * VALSIZE));
+        break;
+    case OP_JMP:
+        emitJump(J, 0, next + readUInt(chunk, offset + 1));
+        break;
+    case OP_JMPBACK:
+        emitJump(J, 0, next - readUInt(chunk, offset + 1));
+        break;
+    case OP_PEJMP:
+    case OP_EJMP:
+        emitStep(J, chunk, offset);
+        emitBranchIfJumped(J, chunk, next, next + readUInt(chunk, offset + 1));
+        break;
+    case OP_NEXT:
+        emitStep(J, chunk, offset);
+        emitBranchIfJumped(J, chunk, next, next + readUInt(chunk, offset + 2));
+        break;
+    case OP_CALL:
+        emitSetPC(J, &chunk->buf[next]);
+        emitMovReg(J, RDI, RBX);
+        emitMovImm32(J, RSI, chunk->buf[offset + 1]);
+        emitMovImm32(J, RDX, chunk->buf[offset + 2]);
+        emitCall(J, (void *)cosmoV_call);
+        break;
+    case OP_CONCAT:
+        emitSetPC(J, &chunk->buf[next]);
+        emitMovReg(J, RDI, RBX);
+        emitMovImm32(J, RSI, chunk->buf[offset + 1]);
+        emitCall(J, (void *)cosmoV_concat);
+        break;
+    case OP_NEWTABLE:
+    case OP_NEWOBJECT:
+        emitSetPC(J, &chunk->buf[next]);
+        emitMovReg(J, RDI, RBX);
+        emitMovImm32(J, RSI, readUInt(chunk, offset + 1));
+        emitCall(J, chunk->buf[offset] == OP_NEWTABLE ? (void *)cosmoV_makeTable
+                                                      : (void *)cosmoV_makeObject);
+        break;
+    case OP_ADD:
+        emitArith(J, chunk, offset, 0x58);
+        break;
+    case OP_SUB:
+        emitArith(J, chunk, offset, 0x5C);
+        break;
+    case OP_MULT:
+        emitArith(J, chunk, offset, 0x59);
+        break;
+    case OP_DIV:
+        emitArith(J, chunk, offset, 0x5E);
+        break;
+    case OP_LESS:
+    case OP_GREATER:
+    case OP_LESS_EQUAL:
+    case OP_GREATER_EQUAL:
+        if (next + 3 <= chunk->count && chunk->buf[next] == OP_PEJMP) {
+            emitCompareJump(J, chunk, offset, next + 3, next + 3 + readUInt(chunk, next + 1),
+                            false);
+        } else {
+            emitStep(J, chunk, offset);
+        }
+        break;
+    case OP_RETURN:
+        emitMovImm32(J, RAX, chunk->buf[offset + 1]);
+        emitEpilogue(J);
+        break;
+    default:
+        emitStep(J, chunk, offset);
+        break;
+    }
+}
+
+#    ifdef COSMOJ_PERFMAP
+// header is the loop header's bytecode offset for traces, -1 for whole functions
+static void writePerfMap(CObjFunction *func, int header, void *code, size_t size)
+{
+    static FILE *perfMap = NULL;
+
+    if (perfMap == NULL) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+        if ((perfMap = fopen(path, "a")) == NULL)
+            return;
+    }
+
+    fprintf(perfMap, "%lx %lx cosmo:%s:%s", (unsigned long)(uintptr_t)code, (unsigned long)size,
+            func->module != NULL ? func->module->str : "?",
+            func->name != NULL ? func->name->str : UNNAMEDCHUNK);
+
+    if (header >= 0)
+        fprintf(perfMap, ":trace@%04d", header);
+
+    fprintf(perfMap, "\n");
+    fflush(perfMap);
+}
+#    endif
+
+// copies the code into its own executable mapping, the mapping size is stored in front of the code
+static void *installCode(JitState *J)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (J->count + 16 + page - 1) & ~(page - 1);
+    uint8_t *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED)
+        return NULL;
+
+    memcpy(mem, &size, sizeof(size_t));
+    memcpy(mem + 16, J->code, J->count);
+
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return NULL;
+    }
+
+    return mem;
+}
+
+static void freeJitState(JitState *J)
+{
+    free(J->code);
+    free(J->patches);
+    free(J->labels);
+}
+
+static void freeCode(void *mem)
+{
+    size_t size;
+
+    memcpy(&size, mem, sizeof(size_t));
+    munmap(mem, size);
+}
+
+static void initConstants()
+{
+    jitTrue = cosmoV_newBoolean(true);
+    jitFalse = cosmoV_newBoolean(false);
+    jitNil = cosmoV_newNil();
+}
+
+bool cosmoJ_compile(CState *state, CObjFunction *func)
+{
+    CChunk *chunk = &func->chunk;
+    JitState J = {0};
+    int offset, size;
+    uint8_t *mem;
+
+    if (VALSIZE != 8 && VALSIZE != 16)
+        return false;
+
+    initConstants();
+
+    J.labels = malloc(sizeof(int) * (chunk->count + 1));
+    for (int i = 0; i <= chunk->count; i++)
+        J.labels[i] = -1;
+
+    emitPrologue(&J);
+    for (offset = 0; offset < chunk->count; offset += size) {
+        size = instrSizeChunk(chunk, offset);
+        if (offset + size > chunk->count)
+            break;
+
+        J.labels[offset] = (int)J.count;
+        emitInstruction(&J, func, offset, size);
+    }
+
+    // a well formed chunk always ends with an OP_RETURN, but just in case
+    J.labels[offset] = (int)J.count;
+    emitMovImm32(&J, RAX, 0);
+    emitEpilogue(&J);
+
+    // resolve the jumps, bailing on anything that doesn't land on an instruction
+    for (int i = 0; i < J.patchCount; i++) {
+        JitPatch *patch = &J.patches[i];
+        int32_t rel;
+
+        if (patch->target < 0 || patch->target > chunk->count || J.labels[patch->target] == -1) {
+            freeJitState(&J);
+            return false;
+        }
+
+        rel = J.labels[patch->target] - (int32_t)(patch->at + 4);
+        memcpy(&J.code[patch->at], &rel, sizeof(int32_t));
+    }
+
+    if ((mem = installCode(&J)) == NULL) {
+        freeJitState(&J);
+        return false;
+    }
+
+#    ifdef COSMOJ_PERFMAP
+    writePerfMap(func, -1, mem + 16, J.count);
+#    endif
+
+    func->jitCode = mem;
+    func->native = (CosmoNative)(void *)(mem + 16);
+    freeJitState(&J);
+    return true;
+}
+
+// ================================================================ [TRACES] ================
+
+/*
+    runs the loop starting at the current frame's pc for one iteration through cosmoV_step,
+    recording every instruction. returns true if the iteration made it back to the loop header, else
+    the recording is aborted & frame->pc is left wherever the interpreter should continue from
+*/
+static bool recordTrace(CState *state, CCallFrame *frame, TraceEntry *entries, int *count)
+{
+    CChunk *chunk = &frame->closure->function->chunk;
+    INSTRUCTION *header = frame->pc;
+
+    *count = 0;
+    for (;;) {
+        int offset = frame->pc - chunk->buf;
+        int next = offset + instrSizeChunk(chunk, offset);
+        INSTRUCTION op = genericOpcode(chunk->buf[offset]);
+        TraceEntry *entry;
+
+        // returning would leave the frame, so that isn't a loop we can trace
+        if (*count >= TRACE_MAX || op == OP_RETURN)
+            return false;
+
+        entry = &entries[(*count)++];
+        entry->offset = offset;
+        entry->flags = 0;
+
+        switch (op) {
+        case OP_JMP:
+            frame->pc = &chunk->buf[next + readUInt(chunk, offset + 1)];
+            continue;
+        case OP_JMPBACK:
+            frame->pc = &chunk->buf[next - readUInt(chunk, offset + 1)];
+            if (frame->pc == header)
+                return true;
+            continue; // an inner loop, it's unrolled into the trace
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MULT:
+        case OP_DIV:
+        case OP_LESS:
+        case OP_GREATER:
+        case OP_LESS_EQUAL:
+        case OP_GREATER_EQUAL:
+            if (IS_NUMBER(*cosmoV_getTop(state, 0)) && IS_NUMBER(*cosmoV_getTop(state, 1)))
+                entry->flags |= TRACE_NUMBERS;
+            break;
+        case OP_INCLOCAL:
+            if (IS_NUMBER(frame->base[chunk->buf[offset + 2]]))
+                entry->flags |= TRACE_NUMBERS;
+            break;
+        default:
+            break;
+        }
+
+        cosmoV_step(state);
+        if (frame->pc != &chunk->buf[next])
+            entry->flags |= TRACE_TAKEN;
+    }
+}
+
+// emits entries[i], returns the # of entries used
+static int emitTraceInstruction(JitState *J, CObjFunction *func, TraceEntry *entries, int i)
+{
+    CChunk *chunk = &func->chunk;
+    TraceEntry *entry = &entries[i];
+    int offset = entry->offset;
+    int next = offset + instrSizeChunk(chunk, offset);
+    bool numbers = entry->flags & TRACE_NUMBERS;
+    bool taken = entry->flags & TRACE_TAKEN;
+
+    switch (genericOpcode(chunk->buf[offset])) {
+    case OP_JMP:
+    case OP_JMPBACK:
+        break; // the trace is already laid out in the order it ran
+    case OP_PEJMP:
+    case OP_EJMP:
+        emitStep(J, chunk, offset);
+        emitGuardPC(J, &chunk->buf[taken ? next + readUInt(chunk, offset + 1) : next]);
+        break;
+    case OP_NEXT:
+        emitStep(J, chunk, offset);
+        emitGuardPC(J, &chunk->buf[taken ? next + readUInt(chunk, offset + 2) : next]);
+        break;
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MULT:
+    case OP_DIV:
+    case OP_INCLOCAL:
+        if (!numbers) {
+            emitStep(J, chunk, offset);
+            break;
+        }
+
+        emitInstruction(J, func, offset, next - offset);
+        break;
+    case OP_LESS:
+    case OP_GREATER:
+    case OP_LESS_EQUAL:
+    case OP_GREATER_EQUAL:
+        // the recorded OP_PEJMP is fused into the comparison
+        if (numbers && entries[i + 1].offset == next && chunk->buf[next] == OP_PEJMP) {
+            int after = next + 3;
+            emitCompareJump(J, chunk, offset, after, after + readUInt(chunk, next + 1),
+                            entries[i + 1].flags & TRACE_TAKEN);
+            return 2;
+        }
+
+        emitStep(J, chunk, offset);
+        break;
+    default:
+        emitInstruction(J, func, offset, next - offset);
+        break;
+    }
+
+    return 1;
+}
+
+static bool compileTrace(CObjFunction *func, CJitTrace *trace, TraceEntry *entries, int count)
+{
+    JitState J = {0};
+    size_t loop;
+    int32_t rel;
+    uint8_t *mem;
+
+    if (VALSIZE != 8 && VALSIZE != 16)
+        return false;
+
+    initConstants();
+    J.trace = true;
+
+    emitPrologue(&J);
+    loop = J.count;
+    for (int i = 0; i < count;)
+        i += emitTraceInstruction(&J, func, entries, i);
+
+    // the last entry is the back-edge
+    emitByte(&J, 0xE9);
+    rel = (int32_t)loop - (int32_t)(J.count + 4);
+    emitU32(&J, (uint32_t)rel);
+
+    if ((mem = installCode(&J)) == NULL) {
+        freeJitState(&J);
+        return false;
+    }
+
+#    ifdef COSMOJ_PERFMAP
+    writePerfMap(func, trace->header, mem + 16, J.count);
+#    endif
+
+    trace->mem = mem;
+    trace->code = (CosmoNative)(void *)(mem + 16);
+    freeJitState(&J);
+    return true;
+}
+
+static CJitTrace *getTrace(CObjFunction *func, int header)
+{
+    CJitTrace *trace;
+
+    for (trace = func->traces; trace != NULL; trace = trace->next) {
+        if (trace->header == header)
+            return trace;
+    }
+
+    if ((trace = malloc(sizeof(CJitTrace))) == NULL)
+        return NULL;
+
+    trace->code = NULL;
+    trace->mem = NULL;
+    trace->header = header;
+    trace->hits = 0;
+    trace->aborts = 0;
+    trace->next = func->traces;
+    func->traces = trace;
+    return trace;
+}
+
+void cosmoJ_backEdge(CState *state, CCallFrame *frame)
+{
+    CObjFunction *func = frame->closure->function;
+    CJitTrace *trace = getTrace(func, frame->pc - func->chunk.buf);
+    TraceEntry entries[TRACE_MAX];
+    int count;
+
+    if (trace == NULL)
+        return;
+
+    if (trace->code == NULL) {
+        if (trace->aborts >= TRACE_MAXABORTS || ++trace->hits < COSMOJ_HOTLOOP)
+            return;
+
+        trace->hits = 0;
+        if (!recordTrace(state, frame, entries, &count) ||
+            !compileTrace(func, trace, entries, count)) {
+            trace->aborts++;
+            return;
+        }
+    }
+
+    trace->code(state, frame);
+}
+
+void cosmoJ_free(CObjFunction *func)
+{
+    CJitTrace *trace = func->traces;
+
+    while (trace != NULL) {
+        CJitTrace *next = trace->next;
+
+        if (trace->mem != NULL)
+            freeCode(trace->mem);
+        free(trace);
+        trace = next;
+    }
+
+    if (func->jitCode != NULL)
+        freeCode(func->jitCode);
+
+    func->traces = NULL;
+    func->jitCode = NULL;
+    func->native = NULL;
+}
+
+#endif
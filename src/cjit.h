@@ -0,0 +1,30 @@
+#ifndef COSMO_JIT_H
+#define COSMO_JIT_H
+
+#include "cobj.h"
+#include "cosmo.h"
+
+#ifdef COSMO_JIT
+
+// # of calls before a function is compiled to native code
+#    define COSMOJ_THRESHOLD 64
+
+// # of times a loop's back-edge is taken before it's traced
+#    define COSMOJ_HOTLOOP 56
+
+// if defined, every compiled function is written to /tmp/perf-<pid>.map so perf can attribute
+// samples to it. the map is never removed, so only enable this while profiling
+// #    define COSMOJ_PERFMAP
+
+/* compiles func's chunk & sets func->native, returns false if the function couldn't be compiled */
+bool cosmoJ_compile(CState *state, CObjFunction *func);
+
+/* called by OP_JMPBACK once frame->pc is at the loop header, runs (or records) the loop's trace */
+void cosmoJ_backEdge(CState *state, CCallFrame *frame);
+
+/* frees the native code & traces (if any) owned by func */
+void cosmoJ_free(CObjFunction *func);
+
+#endif
+
+#endif
@@ -445,9 +445,16 @@ CToken cosmoL_scanToken(CLexState *state)
         return makeToken(state, TOKEN_CARROT);
     case '#':
         return makeToken(state, TOKEN_POUND);
+    case '&':
+        return makeToken(state, TOKEN_AMPERSAND);
+    case '|':
+        return makeToken(state, TOKEN_PIPE);
     case '/':
         return makeToken(state, TOKEN_SLASH);
     // two character tokens
+    case '~':
+        return match(state, '/') ? makeToken(state, TOKEN_TILDE_SLASH)
+                                 : makeToken(state, TOKEN_TILDE);
     case '+':
         return match(state, '+') ? makeToken(state, TOKEN_PLUS_PLUS) : makeToken(state, TOKEN_PLUS);
     case '-':
@@ -464,9 +471,13 @@ CToken cosmoL_scanToken(CLexState *state)
         return match(state, '=') ? makeToken(state, TOKEN_EQUAL_EQUAL)
                                  : makeToken(state, TOKEN_EQUAL);
     case '>':
+        if (match(state, '>'))
+            return makeToken(state, TOKEN_GREATER_GREATER);
         return match(state, '=') ? makeToken(state, TOKEN_GREATER_EQUAL)
                                  : makeToken(state, TOKEN_GREATER);
     case '<':
+        if (match(state, '<'))
+            return makeToken(state, TOKEN_LESS_LESS);
         return match(state, '=') ? makeToken(state, TOKEN_LESS_EQUAL)
                                  : makeToken(state, TOKEN_LESS);
     // literals
@@ -26,7 +26,11 @@ typedef enum
     TOKEN_POUND,
     TOKEN_PERCENT,
     TOKEN_CARROT,
-    TOKEN_EOS, // end of statement
+    TOKEN_AMPERSAND,
+    TOKEN_PIPE,
+    TOKEN_TILDE,
+    TOKEN_TILDE_SLASH, // integer division, '//' is already a comment
+    TOKEN_EOS,         // end of statement
 
     // equality operators
     TOKEN_BANG,
@@ -35,8 +39,10 @@ typedef enum
     TOKEN_EQUAL_EQUAL,
     TOKEN_GREATER,
     TOKEN_GREATER_EQUAL,
+    TOKEN_GREATER_GREATER,
     TOKEN_LESS,
     TOKEN_LESS_EQUAL,
+    TOKEN_LESS_LESS,
 
     // literals
     TOKEN_IDENTIFIER,
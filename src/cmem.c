@@ -8,12 +8,37 @@
 #include "cvalue.h"
 #include "cvm.h"
 
+// an emergency collection has to leave at least this much of the heap limit free. otherwise we'd
+// be running a full collection every few allocations, so the limit counts as exceeded instead
+#define HEAP_LIMIT_HEADROOM(limit) ((limit) / 8)
+
+// throws an error if allocating needed bytes would put us over the heap limit
+static void checkHeapLimit(CState *state, size_t needed)
+{
+    if (state->heapLimit == 0 || cosmoM_isFrozen(state) ||
+        state->allocatedBytes + needed <= state->heapLimit)
+        return;
+
+    // try an emergency collection first
+    cosmoM_collectGarbage(state);
+    if (state->allocatedBytes + needed <= state->heapLimit - HEAP_LIMIT_HEADROOM(state->heapLimit))
+        return;
+
+    // keep the GC (and this check) out of the way while we build the error, cosmoV_throw restores
+    // the freeze count of the panic we unwind to
+    cosmoM_freezeGC(state);
+    cosmoV_error(state, "heap limit exceeded! (%zu bytes)", state->heapLimit);
+}
+
 // realloc wrapper
 void *cosmoM_reallocate(CState *state, void *buf, size_t oldSize, size_t newSize)
 {
     if (buf == NULL)
         oldSize = 0;
 
+    if (newSize > oldSize)
+        checkHeapLimit(state, newSize - oldSize);
+
 #ifdef GC_DEBUG
     printf("old allocated bytes: %ld\n", state->allocatedBytes);
     if (buf) {
@@ -102,18 +127,55 @@ static void tableRemoveWhite(CState *state, CTable *tbl)
     printf("tableRemoveWhite: %p, cap: %d\n", tbl, cap);
 #endif
 
-    for (int i = 0; i < cap; i++) {
+    for (int i = 0; i < cap;) {
         CTableEntry *entry = &tbl->table[i];
         if (IS_REF(entry->key) &&
             !(cosmoV_readRef(entry->key))->isMarked) { // if the key is a object and it's white
                                                        // (unmarked), remove it from the table
-            cosmoT_remove(state, tbl, entry->key);
+            cosmoT_removeSlot(tbl, i);
+            continue; // another entry might've been shifted into this slot
         }
+
+        i++;
     }
 
     cosmoT_checkShrink(state, tbl); // recovers the memory we're no longer using
 }
 
+// strings are interned and primitives can't be collected, so only other objects can be weak
+static inline bool isWeakRef(CValue val)
+{
+    return IS_REF(val) && cosmoV_readRef(val)->type != COBJ_STRING;
+}
+
+static inline bool isAlive(CValue val)
+{
+    return !isWeakRef(val) || cosmoV_readRef(val)->isMarked;
+}
+
+// marks the strong parts of a weak table & remembers it so it can be cleared after marking
+static void markWeakTable(CState *state, CObjTable *tbl)
+{
+    cosmoM_growArray(state, CObj *, state->weakTables.array, state->weakTables.count,
+                     state->weakTables.capacity);
+    state->weakTables.array[state->weakTables.count++] = (CObj *)tbl;
+
+    if (tbl->tbl.table == NULL) // table is still being initialized
+        return;
+
+    int cap = cosmoT_getCapacity(&tbl->tbl);
+    for (int i = 0; i < cap; i++) {
+        CTableEntry *entry = &tbl->tbl.table[i];
+
+        if (!tbl->weakKeys || !isWeakRef(entry->key))
+            markValue(state, entry->key);
+
+        // with weak keys, the value is only kept alive by the key (ephemeron)
+        if (tbl->weakValues ? !isWeakRef(entry->val) : isAlive(entry->key))
+            markValue(state, entry->val);
+    }
+}
+
 static void markArray(CState *state, CValueArray *array)
 {
     for (size_t i = 0; i < array->count; i++) {
@@ -139,7 +201,10 @@ static void blackenObject(CState *state, CObj *obj)
     }
     case COBJ_TABLE: { // tables are just wrappers for CTable
         CObjTable *tbl = (CObjTable *)obj;
-        markTable(state, &tbl->tbl);
+        if (tbl->weakKeys || tbl->weakValues)
+            markWeakTable(state, tbl);
+        else
+            markTable(state, &tbl->tbl);
         break;
     }
     case COBJ_UPVALUE: {
@@ -150,6 +215,7 @@ static void blackenObject(CState *state, CObj *obj)
         CObjFunction *func = (CObjFunction *)obj;
         markObject(state, (CObj *)func->name);
         markObject(state, (CObj *)func->module);
+        markObject(state, (CObj *)func->closure);
         markArray(state, &func->chunk.constants);
 
         break;
@@ -184,7 +250,7 @@ static void blackenObject(CState *state, CObj *obj)
     }
     default:
 #ifdef GC_DEBUG
-        printf("Unknown type in blackenObject with %p, type %d\n", (void *)obj, obj->type);
+        printf("Unknown type in blackenObject with %p, type %d\n", (void *)obj, (int)obj->type);
 #endif
         break;
     }
@@ -229,6 +295,58 @@ static void traceGrays(CState *state)
     }
 }
 
+// marks values of ephemeron entries whose keys turned out to be alive, until nothing changes
+static void convergeEphemerons(CState *state)
+{
+    bool changed;
+
+    do {
+        changed = false;
+        for (int i = 0; i < state->weakTables.count; i++) {
+            CObjTable *tbl = (CObjTable *)state->weakTables.array[i];
+            if (!tbl->weakKeys || tbl->weakValues || tbl->tbl.table == NULL)
+                continue;
+
+            int cap = cosmoT_getCapacity(&tbl->tbl);
+            for (int j = 0; j < cap; j++) {
+                CTableEntry *entry = &tbl->tbl.table[j];
+                if (isAlive(entry->key) && !isAlive(entry->val)) {
+                    markValue(state, entry->val);
+                    changed = true;
+                }
+            }
+        }
+
+        traceGrays(state);
+    } while (changed);
+}
+
+// removes entries with dead weak keys or values
+static void clearWeakTables(CState *state)
+{
+    for (int i = 0; i < state->weakTables.count; i++) {
+        CObjTable *tbl = (CObjTable *)state->weakTables.array[i];
+        if (tbl->tbl.table == NULL)
+            continue;
+
+        int cap = cosmoT_getCapacity(&tbl->tbl);
+        for (int j = 0; j < cap;) {
+            CTableEntry *entry = &tbl->tbl.table[j];
+            if (!IS_NIL(entry->key) && ((tbl->weakKeys && !isAlive(entry->key)) ||
+                                        (tbl->weakValues && !isAlive(entry->val)))) {
+                cosmoT_removeSlot(&tbl->tbl, j);
+                continue; // another entry might've been shifted into this slot
+            }
+
+            j++;
+        }
+
+        cosmoT_checkShrink(state, &tbl->tbl);
+    }
+
+    state->weakTables.count = 0;
+}
+
 static void sweep(CState *state)
 {
     CObj *prev = NULL, *object = state->objects;
@@ -237,15 +355,15 @@ static void sweep(CState *state)
         if (object->isMarked) {       // skip over it
             object->isMarked = false; // reset to white
             prev = object;
-            object = object->next;
+            object = cosmoO_readNext(object);
         } else { // free it!
             CObj *oldObj = object;
 
-            object = object->next;
+            object = cosmoO_readNext(object);
             if (prev == NULL) {
                 state->objects = object;
             } else {
-                prev->next = object;
+                prev->next = (uintptr_t)object;
             }
 
             // call __gc on the object
@@ -271,14 +389,14 @@ static void markRoots(CState *state)
         markValue(state, *value);
     }
 
-    // mark all active callframe closures
+    // mark all active callframe closures & their open upvalues
     for (int i = 0; i < state->frameCount; i++) {
         markObject(state, (CObj *)state->callFrame[i].closure);
-    }
 
-    // mark all open upvalues
-    for (CObjUpval *upvalue = state->openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
-        markObject(state, (CObj *)upvalue);
+        for (CObjUpval *upvalue = state->callFrame[i].openUpvalues; upvalue != NULL;
+             upvalue = upvalue->next) {
+            markObject(state, (CObj *)upvalue);
+        }
     }
 
     markObject(state, (CObj *)state->globals);
@@ -295,6 +413,7 @@ static void markRoots(CState *state)
     }
 
     traceGrays(state);
+    convergeEphemerons(state);
 }
 
 COSMO_API void cosmoM_collectGarbage(CState *state)
@@ -305,6 +424,7 @@ COSMO_API void cosmoM_collectGarbage(CState *state)
     size_t start = state->allocatedBytes;
 #endif
     markRoots(state);
+    clearWeakTables(state);
 
     tableRemoveWhite(
         state,
@@ -324,5 +444,37 @@ COSMO_API void cosmoM_collectGarbage(CState *state)
 
 COSMO_API void cosmoM_updateThreshhold(CState *state)
 {
-    state->nextGC = state->allocatedBytes * HEAP_GROW_FACTOR;
+    size_t next = state->allocatedBytes / 100 * state->gcPause;
+
+    if (next < state->allocatedBytes + state->gcStep)
+        next = state->allocatedBytes + state->gcStep;
+
+    if (next < state->gcMin)
+        next = state->gcMin;
+
+    // don't schedule past the heap limit, we'd rather collect early than throw. the next
+    // collection still has to be some headroom away though, otherwise a heap that's (nearly) full
+    // of live objects would run a full collection on every allocation. checkHeapLimit throws
+    // before that much is allocated anyways
+    if (state->heapLimit != 0 && next > state->heapLimit) {
+        next = state->heapLimit;
+        if (next < state->allocatedBytes + HEAP_LIMIT_HEADROOM(state->heapLimit))
+            next = state->allocatedBytes + HEAP_LIMIT_HEADROOM(state->heapLimit);
+    }
+
+    state->nextGC = next;
+}
+
+COSMO_API void cosmoM_setGCPacing(CState *state, int pause, size_t step, size_t min)
+{
+    state->gcPause = pause < 100 ? 100 : pause;
+    state->gcStep = step;
+    state->gcMin = min;
+    cosmoM_updateThreshhold(state);
+}
+
+COSMO_API void cosmoM_setHeapLimit(CState *state, size_t limit)
+{
+    state->heapLimit = limit;
+    cosmoM_updateThreshhold(state);
 }
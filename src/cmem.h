@@ -7,9 +7,13 @@
 // #define GC_STRESS
 // #define GC_DEBUG
 //  arrays *must* grow by a factor of 2
-#define GROW_FACTOR      2
-#define HEAP_GROW_FACTOR 2
-#define ARRAY_START      8
+#define GROW_FACTOR 2
+#define ARRAY_START 8
+
+// default GC pacing, see cosmoM_setGCPacing
+#define GC_PAUSE_DEFAULT 200        // collect once the heap has doubled since the last collection
+#define GC_STEP_DEFAULT  0          // no minimum growth between collections
+#define GC_MIN_DEFAULT   (1024 * 8) // never schedule a collection below 8kb
 
 #ifdef GC_DEBUG
 #    define cosmoM_freeArray(state, type, buf, capacity)                                           \
@@ -24,8 +28,9 @@
 #define cosmoM_growArray(state, type, buf, count, capacity)                                        \
     if (count >= capacity || buf == NULL) {                                                        \
         int old = capacity;                                                                        \
+        buf = (type *)cosmoM_reallocate(state, buf, sizeof(type) * old,                            \
+                                        sizeof(type) * old * GROW_FACTOR);                         \
         capacity = old * GROW_FACTOR;                                                              \
-        buf = (type *)cosmoM_reallocate(state, buf, sizeof(type) * old, sizeof(type) * capacity);  \
     }
 
 #ifdef GC_DEBUG
@@ -67,6 +72,22 @@ COSMO_API bool cosmoM_checkGarbage(CState *state,
 COSMO_API void cosmoM_collectGarbage(CState *state);
 COSMO_API void cosmoM_updateThreshhold(CState *state);
 
+/*
+    sets how the next GC event is scheduled after each collection:
+        pause : percentage of the surviving heap to grow to before collecting again (200 = 2x)
+        step  : minimum number of bytes the heap is allowed to grow between collections
+        min   : lowest threshhold a collection will ever be scheduled at
+*/
+COSMO_API void cosmoM_setGCPacing(CState *state, int pause, size_t step, size_t min);
+
+/*
+    sets a hard cap on the number of bytes the state may allocate (0 = unlimited). when an
+    allocation would go over the cap an emergency collection is ran, and if that doesn't leave at
+    least 1/8th of the cap free a "heap limit exceeded" error is thrown (which can be caught with
+    pcall)
+*/
+COSMO_API void cosmoM_setHeapLimit(CState *state, size_t limit);
+
 // wrapper for cosmoM_reallocate so we can track our memory usage
 static inline void *cosmoM_xmalloc(CState *state, size_t sz)
 {
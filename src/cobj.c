@@ -1,5 +1,6 @@
 #include "cobj.h"
 
+#include "cjit.h"
 #include "clex.h"
 #include "cmem.h"
 #include "cstate.h"
@@ -22,19 +23,26 @@ uint32_t hashString(const char *str, size_t sz)
     return hash;
 }
 
-CObj *cosmoO_allocateBase(CState *state, size_t sz, CObjType type)
+// links obj into the GC's object list
+static void initBase(CState *state, CObj *obj, CObjType type)
 {
-    CObj *obj = (CObj *)cosmoM_xmalloc(state, sz);
     obj->type = type;
     obj->isMarked = false;
     obj->proto = state->protoObjects[type];
 
-    obj->next = state->objects;
+    COSMOASSERT(((uint64_t)(uintptr_t)obj >> 48) == 0); // see CObj
+    obj->next = (uintptr_t)state->objects;
     state->objects = obj;
 
 #ifdef GC_DEBUG
     printf("allocated %s %p\n", cosmoO_typeStr(obj), obj);
 #endif
+}
+
+CObj *cosmoO_allocateBase(CState *state, size_t sz, CObjType type)
+{
+    CObj *obj = (CObj *)cosmoM_xmalloc(state, sz);
+    initBase(state, obj, type);
     return obj;
 }
 
@@ -45,9 +53,7 @@ void cosmoO_free(CState *state, CObj *obj)
 #endif
     switch (obj->type) {
     case COBJ_STRING: {
-        CObjString *objStr = (CObjString *)obj;
-        cosmoM_freeArray(state, char, objStr->str, objStr->length + 1);
-        cosmoM_free(state, CObjString, objStr);
+        cosmoO_freeStringBuffer(state, (CObjString *)obj);
         break;
     }
     case COBJ_OBJECT: {
@@ -68,6 +74,13 @@ void cosmoO_free(CState *state, CObj *obj)
     }
     case COBJ_FUNCTION: {
         CObjFunction *objFunc = (CObjFunction *)obj;
+        if (objFunc->globalSlots != NULL)
+            cosmoM_freeArray(state, int, objFunc->globalSlots, objFunc->chunk.constants.count);
+        if (objFunc->threaded != NULL)
+            cosmoM_freeArray(state, CThreadedSlot, objFunc->threaded, objFunc->chunk.count);
+#ifdef COSMO_JIT
+        cosmoJ_free(objFunc);
+#endif
         cleanChunk(state, &objFunc->chunk);
         cosmoM_free(state, CObjFunction, objFunc);
         break;
@@ -118,7 +131,15 @@ bool cosmoO_equal(CState *state, CObj *obj1, CObj *obj2)
            metamethod from being checked. If you plan on using `__equal` with strings just remove
            this case!
         */
-        return false;
+        CObjString *str1 = (CObjString *)obj1;
+        CObjString *str2 = (CObjString *)obj2;
+
+        // slices aren't interned, so they have to compare their characters
+        if (str1->isInterned && str2->isInterned)
+            return false;
+
+        return str1->hash == str2->hash && str1->length == str2->length &&
+               memcmp(str1->str, str2->str, str1->length) == 0;
     }
     case COBJ_CFUNCTION: {
         CObjCFunction *cfunc1 = (CObjCFunction *)obj1;
@@ -180,6 +201,11 @@ _eqFail:
 }
 
 CObjObject *cosmoO_newObject(CState *state)
+{
+    return cosmoO_newObjectSized(state, 0);
+}
+
+CObjObject *cosmoO_newObjectSized(CState *state, int fields)
 {
     CObjObject *obj = (CObjObject *)cosmoO_allocateBase(state, sizeof(CObjObject), COBJ_OBJECT);
     obj->istringFlags = 0;
@@ -188,32 +214,53 @@ CObjObject *cosmoO_newObject(CState *state)
     obj->isLocked = false;
 
     cosmoV_pushRef(state, (CObj *)obj); // so our GC can keep track of it
-    cosmoT_initTable(state, &obj->tbl, ARRAY_START);
+    cosmoT_initTable(state, &obj->tbl, cosmoT_capacityFor(fields));
     cosmoV_pop(state);
     return obj;
 }
 
 CObjTable *cosmoO_newTable(CState *state)
+{
+    return cosmoO_newTableSized(state, 0);
+}
+
+CObjTable *cosmoO_newTableSized(CState *state, int entries)
 {
     CObjTable *obj = (CObjTable *)cosmoO_allocateBase(state, sizeof(CObjTable), COBJ_TABLE);
+    obj->weakKeys = false;
+    obj->weakValues = false;
 
     // init the table (might cause a GC event)
     cosmoV_pushRef(state, (CObj *)obj); // so our GC can keep track of obj
-    cosmoT_initTable(state, &obj->tbl, ARRAY_START);
+    cosmoT_initTable(state, &obj->tbl, cosmoT_capacityFor(entries));
     cosmoV_pop(state);
 
     return obj;
 }
 
+void cosmoO_setTableMode(CObjTable *tbl, const char *mode)
+{
+    tbl->weakKeys = strchr(mode, 'k') != NULL;
+    tbl->weakValues = strchr(mode, 'v') != NULL;
+}
+
 CObjFunction *cosmoO_newFunction(CState *state)
 {
     CObjFunction *func =
         (CObjFunction *)cosmoO_allocateBase(state, sizeof(CObjFunction), COBJ_FUNCTION);
     func->args = 0;
     func->upvals = 0;
+    func->maxStack = 0;
     func->variadic = false;
     func->name = NULL;
     func->module = NULL;
+    func->closure = NULL;
+    func->globalSlots = NULL;
+    func->native = NULL;
+    func->jitCode = NULL;
+    func->traces = NULL;
+    func->threaded = NULL;
+    func->calls = 0;
 
     initChunk(state, &func->chunk, ARRAY_START);
     return func;
@@ -280,6 +327,21 @@ CObjUpval *cosmoO_newUpvalue(CState *state, CValue *val)
     return upval;
 }
 
+static CObjString *internString(CState *state, CObjString *strObj, uint32_t hash)
+{
+    initBase(state, (CObj *)strObj, COBJ_STRING);
+    strObj->isIString = false;
+    strObj->isInterned = true;
+    strObj->hash = hash;
+
+    // push/pop to make sure GC doesn't collect it
+    cosmoV_pushRef(state, (CObj *)strObj);
+    cosmoT_insert(state, &state->strings, cosmoV_newRef((CObj *)strObj));
+    cosmoV_pop(state);
+
+    return strObj;
+}
+
 CObjString *cosmoO_copyString(CState *state, const char *str, size_t length)
 {
     uint32_t hash = hashString(str, length);
@@ -289,45 +351,72 @@ CObjString *cosmoO_copyString(CState *state, const char *str, size_t length)
     if (lookup != NULL)
         return lookup;
 
-    char *buf = cosmoM_xmalloc(state, sizeof(char) * (length + 1)); // +1 for null terminator
-    memcpy(buf, str, length);                                       // copy string to heap
-    buf[length] = '\0'; // don't forget our null terminator
+    CObjString *strObj = cosmoO_newStringBuffer(state, length);
+    memcpy(strObj->str, str, length); // copy string to heap
 
-    return cosmoO_allocateString(state, buf, length, hash);
+    return internString(state, strObj, hash);
 }
 
-// length shouldn't include the null terminator! str should be a null terminated string! (char array
-// should also have been allocated using cosmoM_xmalloc!)
-CObjString *cosmoO_takeString(CState *state, char *str, size_t length)
+CObjString *cosmoO_newStringBuffer(CState *state, size_t length)
 {
-    uint32_t hash = hashString(str, length);
+    // +1 for null terminator
+    CObjString *buf = cosmoM_xmalloc(state, sizeof(CObjString) + length + 1);
+    buf->length = length;
+    buf->str[length] = '\0'; // don't forget our null terminator
 
-    CObjString *lookup = cosmoT_lookupString(&state->strings, str, length, hash);
+    return buf;
+}
+
+void cosmoO_freeStringBuffer(CState *state, CObjString *buf)
+{
+    cosmoM_freeArray(state, char, buf, sizeof(CObjString) + buf->length + 1);
+}
+
+CObjString *cosmoO_internString(CState *state, CObjString *buf)
+{
+    uint32_t hash = hashString(buf->str, buf->length);
+    CObjString *lookup = cosmoT_lookupString(&state->strings, buf->str, buf->length, hash);
 
     // have we already interned this string?
     if (lookup != NULL) {
-        cosmoM_freeArray(state, char, str,
-                         length + 1); // free our passed character array, it's unneeded!
+        cosmoO_freeStringBuffer(state, buf); // free our buffer, it's unneeded!
         return lookup;
     }
 
-    return cosmoO_allocateString(state, str, length, hash);
+    return internString(state, buf, hash);
 }
 
-CObjString *cosmoO_allocateString(CState *state, const char *str, size_t sz, uint32_t hash)
+CObjString *cosmoO_sliceString(CState *state, CObjString *str, size_t start, size_t length)
 {
-    CObjString *strObj = (CObjString *)cosmoO_allocateBase(state, sizeof(CObjString), COBJ_STRING);
-    strObj->isIString = false;
-    strObj->str = (char *)str;
-    strObj->length = sz;
-    strObj->hash = hash;
+    CObjString *slice = cosmoO_newStringBuffer(state, length);
+    memcpy(slice->str, str->str + start, length);
 
-    // push/pop to make sure GC doesn't collect it
-    cosmoV_pushRef(state, (CObj *)strObj);
-    cosmoT_insert(state, &state->strings, cosmoV_newRef((CObj *)strObj));
+    initBase(state, (CObj *)slice, COBJ_STRING);
+    slice->isIString = false;
+    slice->isInterned = false;
+    slice->hash = hashString(slice->str, length);
+
+    return slice;
+}
+
+CObjString *cosmoO_internSlice(CState *state, CObjString *str)
+{
+    if (str->isInterned)
+        return str;
+
+    CObjString *lookup = cosmoT_lookupString(&state->strings, str->str, str->length, str->hash);
+
+    // has an equal string already been interned?
+    if (lookup != NULL)
+        return lookup;
+
+    // intern the slice itself
+    str->isInterned = true;
+    cosmoV_pushRef(state, (CObj *)str);
+    cosmoT_insert(state, &state->strings, cosmoV_newRef((CObj *)str));
     cosmoV_pop(state);
 
-    return strObj;
+    return str;
 }
 
 CObjString *cosmoO_pushVFString(CState *state, const char *format, va_list args)
@@ -350,11 +439,18 @@ CObjString *cosmoO_pushVFString(CState *state, const char *format, va_list args)
         c = end[1]; // the character right after '%'
         switch (c) {
         case 'd': // int
-            cosmoV_pushNumber(state, va_arg(args, int));
+            cosmoV_pushInteger(state, va_arg(args, int));
             break;
         case 'f': // double
             cosmoV_pushNumber(state, va_arg(args, double));
             break;
+        case 'z': // size_t, only as %zu
+            if (end[2] == 'u') {
+                cosmoV_pushInteger(state, (cosmo_Integer)va_arg(args, size_t));
+                end++; // skip 'z'
+                break;
+            }
+            // fall through
         case 's':         // char *
             if (len >= 0) // the length is specified
                 cosmoV_pushLString(state, va_arg(args, char *), len);
@@ -441,11 +537,11 @@ void cosmoO_setRawObject(CState *state, CObjObject *proto, CValue key, CValue va
         return;
     }
 
-    // if the key is an IString, we need to reset the cache
-    if (IS_STRING(key) && cosmoV_readString(key)->isIString)
+    // if the key is an IString, we need to reset the cache (a slice could be equal to one)
+    if (IS_STRING(key) && cosmoO_internSlice(state, cosmoV_readString(key))->isIString)
         proto->istringFlags = 0; // reset cache
 
-    if (IS_NIL(val)) { // if we're setting an index to nil, we can safely mark that as a tombstone
+    if (IS_NIL(val)) { // if we're setting an index to nil, we can remove it
         cosmoT_remove(state, &proto->tbl, key);
     } else {
         CValue *newVal = cosmoT_insert(state, &proto->tbl, key);
@@ -637,7 +733,8 @@ cosmo_Number cosmoO_toNumber(CState *state, CObj *obj)
     switch (obj->type) {
     case COBJ_STRING: {
         CObjString *str = (CObjString *)obj;
-        return strtod(str->str, NULL);
+        // "nan(...)" can carry a payload
+        return cosmoV_canonNumber(cosmoV_strToNumber(str->str));
     }
     default: // maybe in the future throw an error?
         return 0;
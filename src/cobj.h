@@ -30,22 +30,30 @@ typedef enum CObjType
 #define setFlagOn(x, flag) (x |= (1u << flag))
 
 typedef int (*CosmoCFunction)(CState *state, int argCount, CValue *args);
+typedef int (*CosmoNative)(CState *state, CCallFrame *frame);
 
+/*
+    the GC's list link, type & mark are packed into a single word so the header is 16 bytes (12 on
+    32-bit), this expects object pointers to fit in 48 bits (true of user space on x86_64 & ARM64).
+    LeakSanitizer & valgrind can't follow the packed link, so every object still alive when the
+    process exits without cosmoV_freeState() is reported as a leak
+*/
 struct CObj
 {
-    struct CObj *next;
+    uint64_t next : 48;       // next object in the GC's list, use cosmoO_readNext()
+    uint64_t type : 8;        // CObjType
+    uint64_t isMarked : 8;    // for the GC
     struct CObjObject *proto; // protoobject, describes the behavior of the object
-    CObjType type;
-    bool isMarked; // for the GC
 };
 
 struct CObjString
 {
     CommonHeader;  // "is a" CObj
-    char *str;     // NULL terminated string
     uint32_t hash; // for hashtable lookup
     int length;
     bool isIString;
+    bool isInterned; // false for slices, see cosmoO_sliceString()
+    char str[];      // NULL terminated string, allocated inline with the object
 };
 
 struct CObjError
@@ -77,6 +85,8 @@ struct CObjTable
 {                 // table, a wrapper for CTable
     CommonHeader; // "is a" CObj
     CTable tbl;
+    bool weakKeys;   // entries are removed once their key is collected (ephemeron)
+    bool weakValues; // entries are removed once their value is collected
 };
 
 struct CObjFunction
@@ -84,9 +94,17 @@ struct CObjFunction
     CommonHeader; // "is a" CObj
     CChunk chunk;
     CObjString *name;
-    CObjString *module; // name of the "module"
+    CObjString *module;       // name of the "module"
+    CObjClosure *closure;     // shared closure, only used if the function has no upvalues
+    int *globalSlots;         // cached globals table slot for each constant (see cosmoV_execute)
+    CosmoNative native;       // if set, this is called instead of interpreting the chunk
+    void *jitCode;            // executable memory backing native (see cjit.c)
+    struct CJitTrace *traces; // compiled loops & back-edge counters (see cjit.c)
+    CThreadedSlot *threaded;  // pre-decoded chunk, built on the first run with VM_THREADED
+    int calls;                // # of times this function was called, used to decide when to compile
     int args;
     int upvals;
+    int maxStack; // # of stack slots the function needs, including the closure & its arguments
     bool variadic;
 };
 
@@ -140,7 +158,8 @@ struct CObjUpval
 #define cosmoV_readError(x)     ((CObjError *)cosmoV_readRef(x))
 
 #define cosmoO_readCString(x)   ((CObjString *)x)->str
-#define cosmoO_readType(x)      ((CObj *)x)->type
+#define cosmoO_readType(x)      ((CObjType)((CObj *)x)->type)
+#define cosmoO_readNext(x)      ((CObj *)(uintptr_t)((CObj *)x)->next)
 
 static inline bool isObjType(CValue val, CObjType type)
 {
@@ -160,6 +179,14 @@ bool cosmoO_isDescendant(CObj *obj, CObjObject *proto);
 
 CObjObject *cosmoO_newObject(CState *state);
 CObjTable *cosmoO_newTable(CState *state);
+
+// same as above, but the table is allocated up front to hold that many entries without a resize
+CObjObject *cosmoO_newObjectSized(CState *state, int fields);
+CObjTable *cosmoO_newTableSized(CState *state, int entries);
+
+// sets the weak mode of the table, mode is a string containing 'k' (weak keys) and/or 'v' (weak
+// values). strings, numbers & other primitives are never considered weak
+void cosmoO_setTableMode(CObjTable *tbl, const char *mode);
 CObjFunction *cosmoO_newFunction(CState *state);
 CObjCFunction *cosmoO_newCFunction(CState *state, CosmoCFunction func);
 CObjError *cosmoO_newError(CState *state, CValue err);
@@ -204,18 +231,31 @@ bool cosmoO_getIString(CState *state, CObjObject *object, int flag, CValue *val)
 // (length should not include the null terminator)
 CObjString *cosmoO_copyString(CState *state, const char *str, size_t length);
 
-// length shouldn't include the null terminator! str should be a null terminated string! (char array
-// should also have been allocated using cosmoM_xmalloc!)
-CObjString *cosmoO_takeString(CState *state, char *str, size_t length);
+// allocates a string buffer with room for length characters (+ the null terminator) which the GC
+// doesn't know about yet. write the characters to ->str, then pass it to cosmoO_internString()
+CObjString *cosmoO_newStringBuffer(CState *state, size_t length);
+
+// frees a buffer from cosmoO_newStringBuffer() that won't be interned
+void cosmoO_freeStringBuffer(CState *state, CObjString *buf);
+
+// interns a filled buffer from cosmoO_newStringBuffer(), if the string was already interned the
+// buffer is freed and the existing string is returned instead
+CObjString *cosmoO_internString(CState *state, CObjString *buf);
+
+// copies length characters of str starting at start into a new string that *isn't* interned, which
+// skips the intern table entirely. slices compare equal to strings with the same characters, and
+// are interned once they're used as a table key (see cosmoO_internSlice())
+CObjString *cosmoO_sliceString(CState *state, CObjString *str, size_t start, size_t length);
 
-// allocates a CObjStruct pointing directly to *str
-CObjString *cosmoO_allocateString(CState *state, const char *str, size_t length, uint32_t hash);
+// returns the interned string equal to str, interning str itself if there isn't one yet
+CObjString *cosmoO_internSlice(CState *state, CObjString *str);
 
 /*
     limited format strings to push onto the VM stack, formatting supported:
 
     '%d' - integers         [int]
     '%f' - floating point   [double]
+    '%zu' - sizes          [size_t]
     '%s' - strings          [char*]
         '%s' also accepts '%*s' which looks for a length specifier before the char* array
 */
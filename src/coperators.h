@@ -42,6 +42,13 @@ typedef enum
     OP_DIV,
     OP_MOD,
     OP_POW,
+    OP_IDIV, // integer division, truncates like OP_MOD
+    OP_BAND,
+    OP_BOR,
+    OP_BXOR,
+    OP_SHL,
+    OP_SHR, // logical shift
+    OP_BNOT,
     OP_NOT,
     OP_NEGATE,
     OP_COUNT,
@@ -65,6 +72,60 @@ typedef enum
     OP_NIL,
 
     OP_RETURN,
+
+    // QUICKENED (rewritten in place by the VM, never emitted by the parser or written to dumps)
+    OP_ADD_INT,
+    OP_SUB_INT,
+    OP_MULT_INT,
+    OP_DIV_INT,
+    OP_LESS_INT,
+    OP_GREATER_INT,
+    OP_LESS_EQUAL_INT,
+    OP_GREATER_EQUAL_INT,
+    OP_ADD_FLOAT,
+    OP_SUB_FLOAT,
+    OP_MULT_FLOAT,
+    OP_DIV_FLOAT,
+    OP_LESS_FLOAT,
+    OP_GREATER_FLOAT,
+    OP_LESS_EQUAL_FLOAT,
+    OP_GREATER_EQUAL_FLOAT,
+    OP_INDEX_TBL,
 } COPCODE; // there can be a max of 256 instructions
 
+// maps a quickened opcode back to the generic instruction it was specialized from
+static inline INSTRUCTION genericOpcode(INSTRUCTION op)
+{
+    switch (op) {
+    case OP_ADD_INT:
+    case OP_ADD_FLOAT:
+        return OP_ADD;
+    case OP_SUB_INT:
+    case OP_SUB_FLOAT:
+        return OP_SUB;
+    case OP_MULT_INT:
+    case OP_MULT_FLOAT:
+        return OP_MULT;
+    case OP_DIV_INT:
+    case OP_DIV_FLOAT:
+        return OP_DIV;
+    case OP_LESS_INT:
+    case OP_LESS_FLOAT:
+        return OP_LESS;
+    case OP_GREATER_INT:
+    case OP_GREATER_FLOAT:
+        return OP_GREATER;
+    case OP_LESS_EQUAL_INT:
+    case OP_LESS_EQUAL_FLOAT:
+        return OP_LESS_EQUAL;
+    case OP_GREATER_EQUAL_INT:
+    case OP_GREATER_EQUAL_FLOAT:
+        return OP_GREATER_EQUAL;
+    case OP_INDEX_TBL:
+        return OP_INDEX;
+    default:
+        return op;
+    }
+}
+
 #endif
@@ -7,6 +7,7 @@
 #include "cstate.h"
 #include "cvm.h"
 
+#include <errno.h>
 #include <stdarg.h>
 #include <string.h>
 
@@ -79,9 +80,13 @@ typedef enum
     PREC_AND,        // and
     PREC_EQUALITY,   // == !=
     PREC_COMPARISON, // < > <= >=
+    PREC_BOR,        // |
+    PREC_BXOR,       // ~
+    PREC_BAND,       // &
+    PREC_SHIFT,      // << >>
     PREC_TERM,       // + -
-    PREC_FACTOR,     // * /
-    PREC_UNARY,      // ! -
+    PREC_FACTOR,     // * / ~/ %
+    PREC_UNARY,      // ! - ~
     PREC_CALL,       // . ()
     PREC_PRIMARY     // everything else
 } Precedence;
@@ -460,27 +465,45 @@ static bool isLast(CParseState *pstate, Precedence pType)
 
 static void number(CParseState *pstate, bool canAssign, Precedence prec)
 {
-    cosmo_Number num = strtod(pstate->previous.start, NULL);
-    writeConstant(pstate, cosmoV_newNumber(num));
+    const char *start = pstate->previous.start;
+
+    // literals without a '.' are integers, unless they're too big for one
+    if (memchr(start, '.', pstate->previous.length) == NULL) {
+        errno = 0;
+        cosmo_Integer num = strtoll(start, NULL, 10);
+
+        if (errno != ERANGE) {
+            writeConstant(pstate, cosmoV_makeInteger(num));
+            return;
+        }
+    }
+
+    writeConstant(pstate, cosmoV_newNumber(cosmoV_strToNumber(start)));
 }
 
 static void hexnumber(CParseState *pstate, bool canAssign, Precedence prec)
 {
-    cosmo_Number num = strtol(pstate->previous.start + 2, NULL, 16); // +2 to skip the '0x'
-    writeConstant(pstate, cosmoV_newNumber(num));
+    // +2 to skip the '0x'
+    cosmo_Integer num = strtoll(pstate->previous.start + 2, NULL, 16);
+    writeConstant(pstate, cosmoV_makeInteger(num));
 }
 
 static void binnumber(CParseState *pstate, bool canAssign, Precedence prec)
 {
-    cosmo_Number num = strtol(pstate->previous.start + 2, NULL, 2); // +2 to skip the '0b'
-    writeConstant(pstate, cosmoV_newNumber(num));
+    // +2 to skip the '0b'
+    cosmo_Integer num = strtoll(pstate->previous.start + 2, NULL, 2);
+    writeConstant(pstate, cosmoV_makeInteger(num));
 }
 
 static void string(CParseState *pstate, bool canAssign, Precedence prec)
 {
     CObjString *strObj =
-        cosmoO_takeString(pstate->state, pstate->previous.start, pstate->previous.length);
+        cosmoO_copyString(pstate->state, pstate->previous.start, pstate->previous.length);
     keepTrackOf(pstate, cosmoV_newRef((CObj *)strObj));
+
+    // string tokens are heap allocated by the lexer, point the token at our copy instead
+    cosmoM_freeArray(pstate->state, char, pstate->previous.start, pstate->previous.length + 1);
+    pstate->previous.start = strObj->str;
     writeConstant(pstate, cosmoV_newRef((CObj *)strObj));
 }
 
@@ -523,6 +546,9 @@ static void unary(CParseState *pstate, bool canAssign, Precedence prec)
     case TOKEN_POUND:
         writeu8Chunk(pstate->state, getChunk(pstate), OP_COUNT, cachedLine);
         break;
+    case TOKEN_TILDE:
+        writeu8Chunk(pstate->state, getChunk(pstate), OP_BNOT, cachedLine);
+        break;
     default:
         error(pstate, "Unexpected unary operator!");
     }
@@ -557,6 +583,25 @@ static void binary(CParseState *pstate, bool canAssign, Precedence prec)
     case TOKEN_CARROT:
         writeu8Chunk(pstate->state, getChunk(pstate), OP_POW, cachedLine);
         break;
+    case TOKEN_TILDE_SLASH:
+        writeu8Chunk(pstate->state, getChunk(pstate), OP_IDIV, cachedLine);
+        break;
+    // BITWISE
+    case TOKEN_AMPERSAND:
+        writeu8Chunk(pstate->state, getChunk(pstate), OP_BAND, cachedLine);
+        break;
+    case TOKEN_PIPE:
+        writeu8Chunk(pstate->state, getChunk(pstate), OP_BOR, cachedLine);
+        break;
+    case TOKEN_TILDE:
+        writeu8Chunk(pstate->state, getChunk(pstate), OP_BXOR, cachedLine);
+        break;
+    case TOKEN_LESS_LESS:
+        writeu8Chunk(pstate->state, getChunk(pstate), OP_SHL, cachedLine);
+        break;
+    case TOKEN_GREATER_GREATER:
+        writeu8Chunk(pstate->state, getChunk(pstate), OP_SHR, cachedLine);
+        break;
     // EQUALITY
     case TOKEN_EQUAL_EQUAL:
         writeu8Chunk(pstate->state, getChunk(pstate), OP_EQUAL, cachedLine);
@@ -1002,7 +1047,7 @@ static void increment(CParseState *pstate, int val)
     }
 
     // increment the old value on the stack
-    writeConstant(pstate, cosmoV_newNumber(val));
+    writeConstant(pstate, cosmoV_newInteger(val));
     writeu8(pstate, OP_ADD);
 }
 
@@ -1046,6 +1091,10 @@ ParseRule ruleTable[] = {
     [TOKEN_STAR]            = {NULL, binary, PREC_FACTOR},
     [TOKEN_PERCENT]         = {NULL, binary, PREC_FACTOR},
     [TOKEN_CARROT]          = {NULL, binary, PREC_FACTOR},
+    [TOKEN_AMPERSAND]       = {NULL, binary, PREC_BAND},
+    [TOKEN_PIPE]            = {NULL, binary, PREC_BOR},
+    [TOKEN_TILDE]           = {unary, binary, PREC_BXOR},
+    [TOKEN_TILDE_SLASH]     = {NULL, binary, PREC_FACTOR},
     [TOKEN_POUND]           = {unary, NULL, PREC_NONE},
     [TOKEN_EOS]             = {NULL, NULL, PREC_NONE},
     [TOKEN_BANG]            = {unary, NULL, PREC_NONE},
@@ -1054,8 +1103,10 @@ ParseRule ruleTable[] = {
     [TOKEN_EQUAL_EQUAL]     = {NULL, binary, PREC_EQUALITY},
     [TOKEN_GREATER]         = {NULL, binary, PREC_COMPARISON},
     [TOKEN_GREATER_EQUAL]   = {NULL, binary, PREC_COMPARISON},
+    [TOKEN_GREATER_GREATER] = {NULL, binary, PREC_SHIFT},
     [TOKEN_LESS]            = {NULL, binary, PREC_COMPARISON},
     [TOKEN_LESS_EQUAL]      = {NULL, binary, PREC_COMPARISON},
+    [TOKEN_LESS_LESS]       = {NULL, binary, PREC_SHIFT},
     [TOKEN_IDENTIFIER]      = {variable, NULL, PREC_NONE},
     [TOKEN_STRING]          = {string, NULL, PREC_NONE},
     [TOKEN_NUMBER]          = {number, NULL, PREC_NONE},
@@ -1767,9 +1818,14 @@ static CObjFunction *endCompiler(CParseState *pstate)
 
     // update pstate to next compiler state
     CCompilerState *cachedCCState = pstate->compiler;
+    CObjFunction *func = cachedCCState->function;
     pstate->compiler = cachedCCState->enclosing;
 
-    return cachedCCState->function;
+    // pushedValues doesn't see every operand, so the chunk itself is walked instead. the frame
+    // starts out with the closure & its arguments
+    func->maxStack = maxStackChunk(pstate->state, &func->chunk, 1 + func->args + func->variadic);
+
+    return func;
 }
 
 // ================================================================ [API]
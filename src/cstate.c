@@ -45,13 +45,19 @@ CState *cosmoV_newState()
     state->grayStack.count = 0;
     state->grayStack.capacity = 2;
     state->grayStack.array = NULL;
+    state->weakTables.count = 0;
+    state->weakTables.capacity = 2;
+    state->weakTables.array = NULL;
     state->allocatedBytes = 0;
-    state->nextGC = 1024 * 8; // threshhold starts at 8kb
+    state->gcPause = GC_PAUSE_DEFAULT;
+    state->gcStep = GC_STEP_DEFAULT;
+    state->gcMin = GC_MIN_DEFAULT;
+    state->heapLimit = 0;
+    state->nextGC = GC_MIN_DEFAULT;
 
     // init stack
     state->top = state->stack;
     state->frameCount = 0;
-    state->openUpvalues = NULL;
 
     // set default proto objects
     for (int i = 0; i < COBJ_MAX; i++) {
@@ -106,7 +112,7 @@ void cosmoV_freeState(CState *state)
     // frees all the objects
     CObj *objs = state->objects;
     while (objs != NULL) {
-        CObj *next = objs->next;
+        CObj *next = cosmoO_readNext(objs);
 
 #ifdef GC_DEBUG
         printf("STATE FREEING %p\n", objs);
@@ -129,6 +135,7 @@ void cosmoV_freeState(CState *state)
 
     // free our gray stack & finally free the state structure
     cosmoM_freeArray(state, CObj *, state->grayStack.array, state->grayStack.capacity);
+    cosmoM_freeArray(state, CObj *, state->weakTables.array, state->weakTables.capacity);
 
 #ifdef GC_DEBUG
     if (state->allocatedBytes != 0) {
@@ -13,6 +13,7 @@ struct CCallFrame
     CObjClosure *closure;
     INSTRUCTION *pc;
     CValue *base;
+    CObjUpval *openUpvalues; // still open upvalues pointing into this frame's locals
 };
 
 typedef enum IStringEnum
@@ -60,15 +61,19 @@ struct CState
     CTable registry;
     ArrayCObj grayStack; // keeps track of which objects *haven't yet* been traversed in our GC, but
                          // *have been* found
+    ArrayCObj weakTables; // weak tables found while marking, cleared before the sweep
 
-    CObjUpval *openUpvalues; // tracks all of our still open (meaning still on the stack) upvalues
     CObjTable *globals;
     CValue *top;   // top of the stack
     CObj *objects; // tracks all of our allocated objects
     CPanic *panic;
 
     size_t allocatedBytes;
-    size_t nextGC; // when allocatedBytes reaches this threshhold, trigger a GC event
+    size_t nextGC;    // when allocatedBytes reaches this threshhold, trigger a GC event
+    size_t gcStep;    // minimum growth (in bytes) between GC events
+    size_t gcMin;     // nextGC is never scheduled below this
+    size_t heapLimit; // hard cap on allocatedBytes (0 = unlimited)
+    int gcPause;      // nextGC = allocatedBytes * gcPause / 100
     int freezeGC;  // when > 0, GC events will be ignored (for internal use)
     int frameCount;
 };
@@ -76,6 +81,9 @@ struct CState
 CPanic *cosmoV_newPanic(CState *state);
 void cosmoV_freePanic(CState *state);
 
+// true when first called, false once an error unwinds back to panic
+#define cosmoV_protect(panic) setjmp(panic->jmp) == 0
+
 COSMO_API CState *cosmoV_newState();
 COSMO_API void cosmoV_freeState(CState *state);
 
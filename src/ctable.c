@@ -4,10 +4,11 @@
 #include "cobj.h"
 #include "cvalue.h"
 
+#include <limits.h>
 #include <string.h>
 
 #define MAX_TABLE_FILL     0.75
-// at 30% capacity with capacity > ARRAY_START, shrink the array
+// below 25% capacity, shrink the array (but never below MIN_TABLE_CAPACITY * GROW_FACTOR)
 #define MIN_TABLE_CAPACITY ARRAY_START
 
 // bit-twiddling hacks, gets the next power of 2
@@ -27,16 +28,32 @@ static unsigned int nextPow2(unsigned int x)
     return power;
 }
 
+// returns the smallest capacity that can hold entries without triggering a resize
+int cosmoT_capacityFor(int entries)
+{
+    int cap = CTABLE_INLINE_CAPACITY;
+    while (entries > (int)(cap * MAX_TABLE_FILL) && cap < (INT_MAX / GROW_FACTOR))
+        cap *= GROW_FACTOR;
+
+    return cap;
+}
+
 void cosmoT_initTable(CState *state, CTable *tbl, int startCap)
 {
     startCap = startCap != 0 ? startCap : ARRAY_START; // sanity check :P
 
-    tbl->capacityMask = startCap - 1;
     tbl->count = 0;
-    tbl->tombstones = 0;
-    tbl->tombThreshold = 32;
-    tbl->table = NULL; // to let out GC know we're initalizing
-    tbl->table = cosmoM_xmalloc(state, sizeof(CTableEntry) * startCap);
+
+    // small tables don't need an allocation at all
+    if (startCap <= CTABLE_INLINE_CAPACITY) {
+        startCap = CTABLE_INLINE_CAPACITY;
+        tbl->table = tbl->inlined;
+    } else {
+        tbl->table = NULL; // to let out GC know we're initalizing
+        tbl->table = cosmoM_xmalloc(state, sizeof(CTableEntry) * startCap);
+    }
+
+    tbl->capacityMask = startCap - 1;
 
     // init everything to NIL
     for (int i = 0; i < startCap; i++) {
@@ -61,7 +78,8 @@ void cosmoT_addTable(CState *state, CTable *from, CTable *to)
 
 void cosmoT_clearTable(CState *state, CTable *tbl)
 {
-    cosmoM_freeArray(state, CTableEntry, tbl->table, cosmoT_getCapacity(tbl));
+    if (tbl->table != tbl->inlined)
+        cosmoM_freeArray(state, CTableEntry, tbl->table, cosmoT_getCapacity(tbl));
 }
 
 static uint32_t getObjectHash(CObj *obj)
@@ -76,6 +94,12 @@ static uint32_t getObjectHash(CObj *obj)
     }
 }
 
+// consecutive integers land in consecutive buckets
+static uint32_t getIntegerHash(cosmo_Integer num)
+{
+    return (uint32_t)num ^ (uint32_t)((uint64_t)num >> 32);
+}
+
 static uint32_t getValueHash(CValue *val)
 {
     switch (GET_TYPE(*val)) {
@@ -83,10 +107,12 @@ static uint32_t getValueHash(CValue *val)
         return getObjectHash(cosmoV_readRef(*val));
     case COSMO_TNUMBER: {
         uint32_t buf[sizeof(cosmo_Number) / sizeof(uint32_t)];
-        cosmo_Number num = cosmoV_readNumber(*val);
+        cosmo_Number num = cosmoV_readFloat(*val);
+        cosmo_Integer integral;
 
-        if (num == 0)
-            return 0;
+        // integral doubles have to hash like the integer they're equal to
+        if (cosmoV_asInteger(*val, &integral))
+            return getIntegerHash(integral);
 
         memcpy(buf, &num, sizeof(buf));
         for (size_t i = 0; i < sizeof(cosmo_Number) / sizeof(uint32_t); i++) {
@@ -94,6 +120,8 @@ static uint32_t getValueHash(CValue *val)
         }
         return buf[0];
     }
+    case COSMO_TINTEGER:
+        return getIntegerHash(cosmoV_readInteger(*val));
     // TODO: add support for other types
     default:
         return 0;
@@ -106,47 +134,27 @@ static CTableEntry *findEntry(CState *state, CTableEntry *entries, int mask, CVa
     uint32_t hash = getValueHash(&key);
     uint32_t indx = hash & mask; // since we know the capacity will *always* be a power of 2, we can
                                  // use bitwise & to perform a MUCH faster mod operation
-    CTableEntry *tomb = NULL;
 
-    // keep looking for an open slot in the entries array
+    // keep looking for an open slot in the entries array. removals shift entries back instead of
+    // leaving tombstones, so the first empty slot always ends the probe
     while (true) {
         CTableEntry *entry = &entries[indx];
 
-        if (IS_NIL(entry->key)) {
-            // check if it's an empty bucket or a tombstone
-            if (IS_NIL(entry->val)) {
-                // it's empty! if we found a tombstone, return that so it'll be reused
-                return tomb != NULL ? tomb : entry;
-            }
-
-            // its a tombstone!
-            tomb = entry;
-        } else if (cosmoV_equal(state, entry->key, key)) {
+        if (IS_NIL(entry->key) || cosmoV_equal(state, entry->key, key))
             return entry;
-        }
 
         indx = (indx + 1) & mask; // fast mod here too
     }
 }
 
-static void resizeTbl(CState *state, CTable *tbl, int newCapacity, bool canShrink)
+static void resizeTbl(CState *state, CTable *tbl, int newCapacity)
 {
-    if (canShrink && cosmoT_checkShrink(state, tbl))
-        return;
-
-    size_t size = sizeof(CTableEntry) * newCapacity;
-    int cachedCount = tbl->count;
-    int newCount, oldCap;
-
-    cosmoM_checkGarbage(state, size); // if this allocation would cause a GC, run the GC
-
-    if (tbl->count < cachedCount) // the GC removed some objects from this table and resized it,
-                                  // ignore our resize event!
-        return;
-
-    CTableEntry *entries = cosmoM_xmalloc(state, size);
-    oldCap = cosmoT_getCapacity(tbl);
-    newCount = 0;
+    // allocate first, this is where the heap limit is enforced & a GC might run. the GC can remove
+    // entries from (and resize) weak tables & the strings table, so the old table is only read
+    // after the allocation, with the GC frozen until the rehash is done
+    CTableEntry *entries = cosmoM_xmalloc(state, sizeof(CTableEntry) * newCapacity);
+    int oldCap = cosmoT_getCapacity(tbl);
+    cosmoM_freezeGC(state);
 
     // set all nodes as NIL : NIL
     for (int i = 0; i < newCapacity; i++) {
@@ -164,26 +172,24 @@ static void resizeTbl(CState *state, CTable *tbl, int newCapacity, bool canShrin
         CTableEntry *newEntry = findEntry(state, entries, newCapacity - 1, oldEntry->key);
         newEntry->key = oldEntry->key;
         newEntry->val = oldEntry->val;
-        newCount++; // inc count
     }
 
     // free the old table
-    cosmoM_freeArray(state, CTableEntry, tbl->table, oldCap);
+    if (tbl->table != tbl->inlined)
+        cosmoM_freeArray(state, CTableEntry, tbl->table, oldCap);
 
     tbl->table = entries;
     tbl->capacityMask = newCapacity - 1;
-    tbl->count = newCount;
-    tbl->tombstones = 0;
+    state->freezeGC--;
 }
 
 bool cosmoT_checkShrink(CState *state, CTable *tbl)
 {
-    // if count > 8 and active entries < tombstones
-    if (tbl->count > MIN_TABLE_CAPACITY &&
-        (tbl->count - tbl->tombstones < tbl->tombstones || tbl->tombstones > tbl->tombThreshold)) {
+    int cap = cosmoT_getCapacity(tbl);
+
+    if (cap > MIN_TABLE_CAPACITY * GROW_FACTOR && tbl->count < cap / 4) {
         // shrink based on active entries to the next pow of 2
-        resizeTbl(state, tbl, nextPow2(tbl->count - tbl->tombstones) * GROW_FACTOR, false);
-        tbl->tombThreshold = tbl->count / 4;
+        resizeTbl(state, tbl, nextPow2(tbl->count) * GROW_FACTOR);
         return true;
     }
 
@@ -198,18 +204,19 @@ COSMO_API CValue *cosmoT_insert(CState *state, CTable *tbl, CValue key)
     if (tbl->count + 1 > (int)(cap * MAX_TABLE_FILL)) {
         // grow table
         int newCap = cap * GROW_FACTOR;
-        resizeTbl(state, tbl, newCap, true);
+        resizeTbl(state, tbl, newCap);
     }
 
+    // keys are always interned, so only lookups with a slice have to compare characters. this has
+    // to happen after the resize since the interned string isn't on the stack for the GC to find
+    if (IS_STRING(key) && !cosmoV_readString(key)->isInterned)
+        key = cosmoV_newRef((CObj *)cosmoO_internSlice(state, cosmoV_readString(key)));
+
     // insert into the table
     CTableEntry *entry = findEntry(state, tbl->table, tbl->capacityMask, key);
 
-    if (IS_NIL(entry->key)) {
-        if (IS_NIL(entry->val)) // is it empty?
-            tbl->count++;
-        else // it's a tombstone, mark it alive!
-            tbl->tombstones--;
-    }
+    if (IS_NIL(entry->key)) // is it empty?
+        tbl->count++;
 
     entry->key = key;
     return &entry->val;
@@ -230,6 +237,19 @@ bool cosmoT_get(CState *state, CTable *tbl, CValue key, CValue *val)
     return !(IS_NIL(entry->key));
 }
 
+int cosmoT_getSlot(CState *state, CTable *tbl, CValue key)
+{
+    // sanity check
+    if (tbl->count == 0)
+        return -1;
+
+    CTableEntry *entry = findEntry(state, tbl->table, tbl->capacityMask, key);
+    if (IS_NIL(entry->key))
+        return -1;
+
+    return (int)(entry - tbl->table);
+}
+
 bool cosmoT_remove(CState *state, CTable *tbl, CValue key)
 {
     if (tbl->count == 0)
@@ -239,19 +259,41 @@ bool cosmoT_remove(CState *state, CTable *tbl, CValue key)
     if (IS_NIL(entry->key)) // sanity check
         return false;
 
-    // crafts tombstone
-    entry->key = cosmoV_newNil(); // this has to be nil
-    entry->val =
-        cosmoV_newBoolean(false); // doesn't really matter what this is, as long as it isn't nil
-    tbl->tombstones++;
-
+    cosmoT_removeSlot(tbl, (int)(entry - tbl->table));
     return true;
 }
 
+void cosmoT_removeSlot(CTable *tbl, int slot)
+{
+    uint32_t mask = tbl->capacityMask;
+    uint32_t hole = slot;
+    uint32_t indx = slot;
+
+    // backward-shift deletion: walk the rest of the probe sequence and move back every entry that
+    // can fill the hole (its home bucket isn't between the hole and where it is now)
+    while (true) {
+        indx = (indx + 1) & mask;
+        CTableEntry *entry = &tbl->table[indx];
+
+        if (IS_NIL(entry->key))
+            break;
+
+        uint32_t home = getValueHash(&entry->key) & mask;
+        if (((indx - home) & mask) >= ((indx - hole) & mask)) {
+            tbl->table[hole] = *entry;
+            hole = indx;
+        }
+    }
+
+    tbl->table[hole].key = cosmoV_newNil();
+    tbl->table[hole].val = cosmoV_newNil();
+    tbl->count--;
+}
+
 // returns the active entry count
 COSMO_API int cosmoT_count(CTable *tbl)
 {
-    return tbl->count - tbl->tombstones;
+    return tbl->count;
 }
 
 CObjString *cosmoT_lookupString(CTable *tbl, const char *str, int length, uint32_t hash)
@@ -268,9 +310,10 @@ CObjString *cosmoT_lookupString(CTable *tbl, const char *str, int length, uint32
         CTableEntry *entry = &tbl->table[indx];
 
         // check if it's an empty slot (meaning we dont have it in the table)
-        if (IS_NIL(entry->key) && IS_NIL(entry->val)) {
+        if (IS_NIL(entry->key)) {
             return NULL;
-        } else if (IS_STRING(entry->key) && cosmoV_readString(entry->key)->length == length &&
+        } else if (IS_STRING(entry->key) && cosmoV_readString(entry->key)->hash == hash &&
+                   cosmoV_readString(entry->key)->length == length &&
                    memcmp(cosmoV_readString(entry->key)->str, str, length) == 0) {
             // it's a match!
             return (CObjString *)cosmoV_readRef(entry->key);
@@ -13,18 +13,22 @@ typedef struct CTableEntry
     CValue val;
 } CTableEntry;
 
+// tables this small live inline in their CTable instead of on the heap, must be a power of 2
+#define CTABLE_INLINE_CAPACITY 4
+
 typedef struct CTable
 {
     int count;
     int capacityMask; // +1 to get the capacity
-    int tombstones;
-    int tombThreshold;
-    CTableEntry *table;
+    CTableEntry *table; // points to inlined until the table outgrows it
+    CTableEntry inlined[CTABLE_INLINE_CAPACITY];
 } CTable;
 
 #define cosmoT_getCapacity(tbl) ((tbl)->capacityMask + 1)
 
+// startCap must be a power of 2, cosmoT_capacityFor() gives the right one for a number of entries
 COSMO_API void cosmoT_initTable(CState *state, CTable *tbl, int startCap);
+COSMO_API int cosmoT_capacityFor(int entries);
 COSMO_API void cosmoT_clearTable(CState *state, CTable *tbl);
 COSMO_API int cosmoT_count(CTable *tbl);
 
@@ -33,8 +37,16 @@ bool cosmoT_checkShrink(CState *state, CTable *tbl);
 CObjString *cosmoT_lookupString(CTable *tbl, const char *str, int length, uint32_t hash);
 CValue *cosmoT_insert(CState *state, CTable *tbl, CValue key);
 bool cosmoT_get(CState *state, CTable *tbl, CValue key, CValue *val);
+
+// returns the index of key's entry in tbl->table, or -1 if the key isn't in the table. the index
+// stays valid until the table is resized or the key is removed
+int cosmoT_getSlot(CState *state, CTable *tbl, CValue key);
 bool cosmoT_remove(CState *state, CTable *tbl, CValue key);
 
+// removes the entry at slot, entries after it may be moved back to fill the gap (so when removing
+// while walking the table, check the same slot again)
+void cosmoT_removeSlot(CTable *tbl, int slot);
+
 void cosmoT_printTable(CTable *tbl, const char *name);
 
 #endif
@@ -13,6 +13,9 @@ typedef struct
     int readerStatus;
 } UndumpState;
 
+// a dumped NaN could carry a payload, see cosmoV_canonNumber()
+#define cosmoV_newCanonNumber(x) cosmoV_newNumber(cosmoV_canonNumber(x))
+
 static bool readCValue(UndumpState *udstate, CValue *val);
 
 #define check(e)                                                                                   \
@@ -31,9 +34,15 @@ static void initUndumpState(CState *state, UndumpState *udstate, cosmo_Reader re
 
 static bool readBlock(UndumpState *udstate, void *data, size_t size)
 {
+    /* empty strings & vectors have nothing to read */
+    if (size == 0)
+        return udstate->readerStatus == 0;
+
     if (udstate->readerStatus == 0) {
-        /* if reader returns 1, we expect an error was thrown */
+        /* a reader that fails without throwing its own error (eg. a truncated dump) gets ours */
         udstate->readerStatus = udstate->reader(udstate->state, data, size, udstate->userData);
+        if (udstate->readerStatus != 0)
+            cosmoV_error(udstate->state, "failed to read dump!");
     }
 
     return udstate->readerStatus == 0;
@@ -94,7 +103,7 @@ static bool checkHeader(UndumpState *udstate)
 static bool readCObjString(UndumpState *udstate, CObjString **str)
 {
     uint32_t size;
-    char *data;
+    CObjString *buf;
 
     check(readu32(udstate, (uint32_t *)&size));
     if (size == 0) { /* empty string */
@@ -102,18 +111,21 @@ static bool readCObjString(UndumpState *udstate, CObjString **str)
         return true;
     }
 
-    data = cosmoM_xmalloc(udstate->state, size + 1);
-    check(readBlock(udstate, (void *)data, size));
-    data[size] = '\0'; /* add NULL-terminator */
+    buf = cosmoO_newStringBuffer(udstate->state, size);
+    if (!readBlock(udstate, (void *)buf->str, size)) {
+        cosmoO_freeStringBuffer(udstate->state, buf);
+        return false;
+    }
 
-    *str = cosmoO_takeString(udstate->state, data, size);
+    *str = cosmoO_internString(udstate->state, buf);
     return true;
 }
 
 static bool readCObjFunction(UndumpState *udstate, CObjFunction **func)
 {
-    size_t constants;
+    size_t constants, lines;
     CValue val;
+    uint8_t variadic;
 
     *func = cosmoO_newFunction(udstate->state);
 
@@ -125,13 +137,25 @@ static bool readCObjFunction(UndumpState *udstate, CObjFunction **func)
 
     check(readu32(udstate, (uint32_t *)&(*func)->args));
     check(readu32(udstate, (uint32_t *)&(*func)->upvals));
-    check(readu8(udstate, (uint8_t *)&(*func)->variadic));
+    check(readu8(udstate, &variadic));
+    (*func)->variadic = variadic != 0;
 
     /* read chunk info */
     check(
         readVector(udstate, (void **)&(*func)->chunk.buf, sizeof(uint8_t), &(*func)->chunk.count));
-    check(
-        readVector(udstate, (void **)&(*func)->chunk.lineInfo, sizeof(int), &(*func)->chunk.count));
+    (*func)->chunk.capacity = (*func)->chunk.count;
+    check(readVector(udstate, (void **)&(*func)->chunk.lineInfo, sizeof(CLineInfo), &lines));
+    (*func)->chunk.lineCount = (*func)->chunk.lineCapacity = lines;
+
+    /* runs have to be sorted for getLineChunk's binary search */
+    for (size_t i = 0; i < lines; i++) {
+        CLineInfo *info = &(*func)->chunk.lineInfo[i];
+        if (info->offset < 0 || info->offset >= (*func)->chunk.count ||
+            (i > 0 && info->offset <= info[-1].offset)) {
+            cosmoV_error(udstate->state, "bad line info!");
+            return false;
+        }
+    }
 
     /* read constants */
     check(readSize(udstate, &constants));
@@ -140,6 +164,10 @@ static bool readCObjFunction(UndumpState *udstate, CObjFunction **func)
         addConstant(udstate->state, &(*func)->chunk, val);
     }
 
+    /* dumps can come from anywhere, nothing in the chunk is trusted until it's verified (this also
+       computes the max stack, which isn't dumped) */
+    check(validateChunk(udstate->state, *func));
+
     /* pop function off stack */
     cosmoV_pop(udstate->state);
     return true;
@@ -152,7 +180,12 @@ static bool readCObj(UndumpState *udstate, CObj **obj)
 
     switch (type) {
     case COBJ_STRING:
-        return readCObjString(udstate, (CObjString **)obj);
+        check(readCObjString(udstate, (CObjString **)obj));
+
+        // an empty string is dumped the same as a missing name, but a constant is never NULL
+        if (*obj == NULL)
+            *obj = (CObj *)cosmoO_copyString(udstate->state, "", 0);
+        return true;
     case COBJ_FUNCTION:
         return readCObjFunction(udstate, (CObjFunction **)obj);
     default:
@@ -178,7 +211,9 @@ static bool readCValue(UndumpState *udstate, CValue *val)
 
     switch (t) {
     case COSMO_TNUMBER:
-        READ_VAR(udstate, val, cosmo_Number, cosmoV_newNumber)
+        READ_VAR(udstate, val, cosmo_Number, cosmoV_newCanonNumber)
+    case COSMO_TINTEGER: // promoted if this build's integers are narrower than the dump's
+        READ_VAR(udstate, val, cosmo_Integer, cosmoV_makeInteger)
     case COSMO_TBOOLEAN:
         READ_VAR(udstate, val, bool, cosmoV_newBoolean)
     case COSMO_TREF: {
@@ -214,6 +249,12 @@ int cosmoD_undump(CState *state, cosmo_Reader reader, const void *userData, CObj
         return 1;
     }
 
+    /* the main function is never given any upvalues to capture */
+    if ((*func)->upvals != 0) {
+        cosmoV_error(state, "bad main function!");
+        return 1;
+    }
+
     cosmoV_pushRef(state, (CObj *)*func);
     return udstate.readerStatus;
 }
\ No newline at end of file
@@ -4,6 +4,12 @@
 #include "cobj.h"
 #include "cosmo.h"
 
+#include <ctype.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
 void initValArray(CState *state, CValueArray *val, size_t startCapacity)
 {
     val->count = 0;
@@ -25,6 +31,14 @@ void appendValArray(CState *state, CValueArray *array, CValue val)
 
 bool cosmoV_equal(CState *state, CValue valA, CValue valB)
 {
+    // integers & doubles compare by value, so 1 == 1.0
+    if (IS_NUMBER(valA) && IS_NUMBER(valB)) {
+        if (IS_INTEGER(valA) && IS_INTEGER(valB))
+            return cosmoV_readInteger(valA) == cosmoV_readInteger(valB);
+
+        return cosmoV_readNumber(valA) == cosmoV_readNumber(valB);
+    }
+
     if (GET_TYPE(valA) != GET_TYPE(valB)) // are they the same type?
         return false;
 
@@ -32,8 +46,6 @@ bool cosmoV_equal(CState *state, CValue valA, CValue valB)
     switch (GET_TYPE(valA)) {
     case COSMO_TBOOLEAN:
         return cosmoV_readBoolean(valA) == cosmoV_readBoolean(valB);
-    case COSMO_TNUMBER:
-        return cosmoV_readNumber(valA) == cosmoV_readNumber(valB);
     case COSMO_TREF:
         return cosmoO_equal(state, cosmoV_readRef(valA), cosmoV_readRef(valB));
     case COSMO_TNIL:
@@ -43,13 +55,140 @@ bool cosmoV_equal(CState *state, CValue valA, CValue valB)
     }
 }
 
+static const char digitPairs[] = "00010203040506070809"
+                                 "10111213141516171819"
+                                 "20212223242526272829"
+                                 "30313233343536373839"
+                                 "40414243444546474849"
+                                 "50515253545556575859"
+                                 "60616263646566676869"
+                                 "70717273747576777879"
+                                 "80818283848586878889"
+                                 "90919293949596979899";
+
+// writes num to buf two digits at a time, returns the length
+static int integerToStr(cosmo_Integer num, char *buf)
+{
+    char tmp[24];
+    char *start = tmp + sizeof(tmp);
+    uint64_t n = num < 0 ? 0 - (uint64_t)num : (uint64_t)num;
+
+    while (n >= 100) {
+        start -= 2;
+        memcpy(start, &digitPairs[(n % 100) * 2], 2);
+        n /= 100;
+    }
+
+    if (n >= 10) {
+        start -= 2;
+        memcpy(start, &digitPairs[n * 2], 2);
+    } else {
+        *--start = '0' + n;
+    }
+
+    if (num < 0)
+        *--start = '-';
+
+    int len = tmp + sizeof(tmp) - start;
+    memcpy(buf, start, len);
+    buf[len] = '\0';
+    return len;
+}
+
+int cosmoV_numberToStr(CValue val, char *buf)
+{
+    if (IS_INTEGER(val))
+        return integerToStr(cosmoV_readInteger(val), buf);
+
+    cosmo_Number num = cosmoV_readFloat(val);
+
+    // integral doubles with less than 15 digits print without an exponent under "%.14g", so they
+    // can take the integer path too (-0 still goes to snprintf for its sign)
+    if (num > -1e14 && num < 1e14 && num == (cosmo_Number)(cosmo_Integer)num &&
+        !(num == 0 && signbit(num)))
+        return integerToStr((cosmo_Integer)num, buf);
+
+    return snprintf(buf, COSMO_NUMBER_BUFSZ, "%.14g", num);
+}
+
+// every power of 10 a double can hold exactly
+static const cosmo_Number exactPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                          1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                          1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/*
+    if the digits fit in 53 bits & the exponent is small enough, digits * 10^exp (or digits /
+   10^-exp) is a single correctly rounded operation between two exact doubles. anything else (long
+   mantissas, big exponents, hex, inf, nan) falls back to strtod()
+*/
+cosmo_Number cosmoV_strToNumber(const char *str)
+{
+    const char *curr = str;
+    uint64_t digits = 0;
+    int exponent = 0;
+    bool negative = false, any = false;
+
+    while (isspace((unsigned char)*curr))
+        curr++;
+
+    if (*curr == '-' || *curr == '+')
+        negative = *curr++ == '-';
+
+    for (; isdigit((unsigned char)*curr); curr++, any = true) {
+        if (digits >= (UINT64_C(1) << 53) / 10)
+            return strtod(str, NULL);
+        digits = digits * 10 + (*curr - '0');
+    }
+
+    if (*curr == '.') {
+        for (curr++; isdigit((unsigned char)*curr); curr++, any = true) {
+            if (digits >= (UINT64_C(1) << 53) / 10)
+                return strtod(str, NULL);
+            digits = digits * 10 + (*curr - '0');
+            exponent--;
+        }
+    }
+
+    // hex (0x...) or no digits at all (inf, nan, etc.)
+    if (!any || *curr == 'x' || *curr == 'X')
+        return strtod(str, NULL);
+
+    if (*curr == 'e' || *curr == 'E') {
+        const char *exp = curr + 1;
+        bool negExp = false;
+        int value = 0;
+
+        if (*exp == '-' || *exp == '+')
+            negExp = *exp++ == '-';
+
+        // "1e" is just 1
+        if (isdigit((unsigned char)*exp)) {
+            for (; isdigit((unsigned char)*exp); exp++) {
+                if (value > 1000)
+                    return strtod(str, NULL);
+                value = value * 10 + (*exp - '0');
+            }
+
+            exponent += negExp ? -value : value;
+        }
+    }
+
+    if (exponent < -22 || exponent > 22)
+        return strtod(str, NULL);
+
+    cosmo_Number num = exponent < 0 ? (cosmo_Number)digits / exactPow10[-exponent]
+                                    : (cosmo_Number)digits * exactPow10[exponent];
+    return negative ? -num : num;
+}
+
 CObjString *cosmoV_toString(CState *state, CValue val)
 {
     switch (GET_TYPE(val)) {
-    case COSMO_TNUMBER: {
-        char buf[32];
-        int size = snprintf((char *)&buf, 32, "%.14g", cosmoV_readNumber(val));
-        return cosmoO_copyString(state, (char *)&buf, size);
+    case COSMO_TNUMBER:
+    case COSMO_TINTEGER: {
+        char buf[COSMO_NUMBER_BUFSZ];
+        int size = cosmoV_numberToStr(val, buf);
+        return cosmoO_copyString(state, buf, size);
     }
     case COSMO_TBOOLEAN: {
         return cosmoV_readBoolean(val) ? cosmoO_copyString(state, "true", 4)
@@ -69,7 +208,8 @@ CObjString *cosmoV_toString(CState *state, CValue val)
 cosmo_Number cosmoV_toNumber(CState *state, CValue val)
 {
     switch (GET_TYPE(val)) {
-    case COSMO_TNUMBER: {
+    case COSMO_TNUMBER:
+    case COSMO_TINTEGER: {
         return cosmoV_readNumber(val);
     }
     case COSMO_TBOOLEAN: {
@@ -92,6 +232,7 @@ const char *cosmoV_typeStr(CValue val)
     case COSMO_TBOOLEAN:
         return "<bool>";
     case COSMO_TNUMBER:
+    case COSMO_TINTEGER:
         return "<number>";
     case COSMO_TREF:
         return cosmoO_typeStr(cosmoV_readRef(val));
@@ -107,6 +248,9 @@ void cosmoV_printValue(CValue val)
     case COSMO_TNUMBER:
         printf("%g", cosmoV_readNumber(val));
         break;
+    case COSMO_TINTEGER:
+        printf("%" PRId64, cosmoV_readInteger(val));
+        break;
     case COSMO_TBOOLEAN:
         printf(cosmoV_readBoolean(val) ? "true" : "false");
         break;
@@ -5,13 +5,15 @@
 
 typedef enum
 {
-    COSMO_TNUMBER, // number has to be 0 because NaN box
+    COSMO_TNUMBER,  // number has to be 0 because NaN box
+    COSMO_TINTEGER, // integer subtype of <number>, IS_NUMBER() is true for both
     COSMO_TBOOLEAN,
     COSMO_TREF,
     COSMO_TNIL,
 } CosmoType;
 
 typedef double cosmo_Number;
+typedef int64_t cosmo_Integer;
 
 /*
     holds primitive cosmo types
@@ -27,6 +29,15 @@ typedef double cosmo_Number;
     both are great resources :)
 
     TL;DR: we can store payloads in the NaN value in the IEEE 754 standard.
+
+    every non-double lives in the negative quiet NaN space: the top 16 bits are 0xfff8 | type, with
+    the 48 bit payload below them. type 0 (0xfff8) is left to doubles since it's x86's default NaN,
+    so every double compares below INT_SIG & every <number> below BOOL_SIG, making each type check a
+    single compare.
+
+    the VM only ever makes payload-free NaNs, so a NaN can't alias a boxed value (even once its sign
+    is flipped). doubles from outside the VM (cosmoV_pushNumber(), dumps) go through
+    cosmoV_canonNumber() to keep it that way.
 */
 union CValue
 {
@@ -34,38 +45,51 @@ union CValue
     cosmo_Number num;
 };
 
-#    define MASK_TYPE       ((uint64_t)0x0007000000000000)
-#    define MASK_PAYLOAD    ((uint64_t)0x0000ffffffffffff)
-
-// 3 bits (low bits) are reserved for the type
-#    define MAKE_PAYLOAD(x) ((uint64_t)(x)&MASK_PAYLOAD)
-#    define READ_PAYLOAD(x) ((x).data & MASK_PAYLOAD)
+#    define MASK_PAYLOAD          ((uint64_t)0x0000ffffffffffff)
+#    define READ_PAYLOAD(x)       ((x).data & MASK_PAYLOAD)
 
-// The bits that must be set to indicate a quiet NaN.
-#    define MASK_QUIETNAN   ((uint64_t)0x7ff8000000000000)
+#    define MAKE_SIG(type)        (((uint64_t)0xfff8 | (type)) << 48)
+#    define INT_SIG               MAKE_SIG(COSMO_TINTEGER)
+#    define BOOL_SIG              MAKE_SIG(COSMO_TBOOLEAN)
+#    define OBJ_SIG               MAKE_SIG(COSMO_TREF)
+#    define NIL_SIG               MAKE_SIG(COSMO_TNIL)
+#    define CANON_NAN             ((uint64_t)0x7ff8000000000000)
 
 #    define GET_TYPE(x)                                                                            \
-        ((((x).data & MASK_QUIETNAN) == MASK_QUIETNAN) ? (((x).data & MASK_TYPE) >> 48)            \
-                                                       : COSMO_TNUMBER)
+        ((x).data < INT_SIG ? COSMO_TNUMBER : (CosmoType)(((x).data >> 48) & 0x7))
 
-#    define SIG_MASK              (MASK_QUIETNAN | MASK_TYPE)
-#    define BOOL_SIG              (MASK_QUIETNAN | ((uint64_t)(COSMO_TBOOLEAN) << 48))
-#    define OBJ_SIG               (MASK_QUIETNAN | ((uint64_t)(COSMO_TREF) << 48))
-#    define NIL_SIG               (MASK_QUIETNAN | ((uint64_t)(COSMO_TNIL) << 48))
+// integers live in the 48 bit payload, arithmetic outside of that is promoted to a double while
+// bitwise results wrap around to 48 bits
+#    define COSMO_INTEGER_MAX     (((cosmo_Integer)1 << 47) - 1)
+#    define COSMO_INTEGER_MIN     (-((cosmo_Integer)1 << 47))
+#    define COSMO_INTEGER_MASK    MASK_PAYLOAD
 
-#    define cosmoV_newNumber(x)   ((CValue){.num = x})
-#    define cosmoV_newBoolean(x)  ((CValue){.data = MAKE_PAYLOAD(x) | BOOL_SIG})
-#    define cosmoV_newRef(x)      ((CValue){.data = MAKE_PAYLOAD((uintptr_t)x) | OBJ_SIG})
+// pointers are expected to fit in the payload, which user space pointers do on x86_64 & ARM64
+#    define cosmoV_newNumber(x)   ((CValue){.num = (x)})
+#    define cosmoV_newInteger(x)  ((CValue){.data = ((uint64_t)(x) & MASK_PAYLOAD) | INT_SIG})
+#    define cosmoV_newBoolean(x)  ((CValue){.data = (uint64_t)(bool)(x) | BOOL_SIG})
+#    define cosmoV_newRef(x)      ((CValue){.data = (uint64_t)(uintptr_t)(x) | OBJ_SIG})
 #    define cosmoV_newNil()       ((CValue){.data = NIL_SIG})
 
-#    define cosmoV_readNumber(x)  ((x).num)
-#    define cosmoV_readBoolean(x) ((bool)READ_PAYLOAD(x))
-#    define cosmoV_readRef(x)     ((CObj *)READ_PAYLOAD(x))
+#    define cosmoV_readFloat(x)   ((x).num)
+// sign extends the 48 bit payload
+#    define cosmoV_readInteger(x)                                                                  \
+        ((cosmo_Integer)(READ_PAYLOAD(x) ^ ((uint64_t)1 << 47)) - ((cosmo_Integer)1 << 47))
+#    define cosmoV_readBoolean(x) ((bool)((x).data & 1))
+#    define cosmoV_readRef(x)     ((CObj *)(uintptr_t)READ_PAYLOAD(x))
 
-#    define IS_NUMBER(x)          (((x).data & MASK_QUIETNAN) != MASK_QUIETNAN)
-#    define IS_BOOLEAN(x)         (((x).data & SIG_MASK) == BOOL_SIG)
-#    define IS_NIL(x)             (((x).data & SIG_MASK) == NIL_SIG)
-#    define IS_REF(x)             (((x).data & SIG_MASK) == OBJ_SIG)
+#    define IS_FLOAT(x)           ((x).data < INT_SIG)
+#    define IS_INTEGER(x)         (((x).data >> 48) == (INT_SIG >> 48))
+#    define IS_NUMBER(x)          ((x).data < BOOL_SIG)
+#    define IS_BOOLEAN(x)         (((x).data >> 48) == (BOOL_SIG >> 48))
+#    define IS_NIL(x)             ((x).data == NIL_SIG)
+#    define IS_REF(x)             (((x).data >> 48) == (OBJ_SIG >> 48))
+
+// a NaN from outside the VM might carry a payload, those are swapped for a plain NaN
+static inline cosmo_Number cosmoV_canonNumber(cosmo_Number num)
+{
+    return num != num ? ((CValue){.data = CANON_NAN}).num : num;
+}
 
 #else
 /*
@@ -77,6 +101,7 @@ struct CValue
     union
     {
         cosmo_Number num;
+        cosmo_Integer i;
         bool b; // boolean
         CObj *obj;
     } val;
@@ -84,28 +109,131 @@ struct CValue
 
 #    define GET_TYPE(x)           ((x).type)
 
+#    define COSMO_INTEGER_MAX     INT64_MAX
+#    define COSMO_INTEGER_MIN     INT64_MIN
+#    define COSMO_INTEGER_MASK    UINT64_MAX
+
 // create CValues
 
 #    define cosmoV_newNumber(x)   ((CValue){COSMO_TNUMBER, {.num = (x)}})
+#    define cosmoV_newInteger(x)  ((CValue){COSMO_TINTEGER, {.i = (x)}})
 #    define cosmoV_newBoolean(x)  ((CValue){COSMO_TBOOLEAN, {.b = (x)}})
 #    define cosmoV_newRef(x)      ((CValue){COSMO_TREF, {.obj = (CObj *)(x)}})
 #    define cosmoV_newNil()       ((CValue){COSMO_TNIL, {.num = 0}})
 
 // read CValues
 
-#    define cosmoV_readNumber(x)  ((cosmo_Number)(x).val.num)
+#    define cosmoV_readFloat(x)   ((cosmo_Number)(x).val.num)
+#    define cosmoV_readInteger(x) ((cosmo_Integer)(x).val.i)
 #    define cosmoV_readBoolean(x) ((bool)(x).val.b)
 
 // grabs the CObj* pointer from the CValue
 #    define cosmoV_readRef(x)     ((CObj *)(x).val.obj)
 
-#    define IS_NUMBER(x)          (GET_TYPE(x) == COSMO_TNUMBER)
+#    define IS_FLOAT(x)           (GET_TYPE(x) == COSMO_TNUMBER)
+#    define IS_INTEGER(x)         (GET_TYPE(x) == COSMO_TINTEGER)
+#    define IS_NUMBER(x)          ((unsigned)GET_TYPE(x) <= COSMO_TINTEGER)
 #    define IS_BOOLEAN(x)         (GET_TYPE(x) == COSMO_TBOOLEAN)
 #    define IS_NIL(x)             (GET_TYPE(x) == COSMO_TNIL)
 #    define IS_REF(x)             (GET_TYPE(x) == COSMO_TREF)
 
+#    define cosmoV_canonNumber(x) (x)
+
 #endif
 
+/*
+    <number>s are either doubles or integers. cosmoV_newInteger() expects x to already be between
+    COSMO_INTEGER_MIN & COSMO_INTEGER_MAX, the helpers below promote results that aren't to a double
+*/
+
+// reads either kind of number as a double
+#define cosmoV_readNumber(x)                                                                       \
+    (IS_INTEGER(x) ? (cosmo_Number)cosmoV_readInteger(x) : cosmoV_readFloat(x))
+
+static inline CValue cosmoV_makeInteger(cosmo_Integer num)
+{
+    if (num < COSMO_INTEGER_MIN || num > COSMO_INTEGER_MAX)
+        return cosmoV_newNumber((cosmo_Number)num);
+
+    return cosmoV_newInteger(num);
+}
+
+// the sums are done unsigned so they wrap instead of being undefined, a wrapped result's sign
+// differs from both operands'
+static inline CValue cosmoV_addInteger(cosmo_Integer a, cosmo_Integer b)
+{
+    cosmo_Integer res = (cosmo_Integer)((uint64_t)a + (uint64_t)b);
+
+    if (((a ^ res) & (b ^ res)) < 0)
+        return cosmoV_newNumber((cosmo_Number)a + (cosmo_Number)b);
+
+    return cosmoV_makeInteger(res);
+}
+
+static inline CValue cosmoV_subInteger(cosmo_Integer a, cosmo_Integer b)
+{
+    cosmo_Integer res = (cosmo_Integer)((uint64_t)a - (uint64_t)b);
+
+    if (((a ^ b) & (a ^ res)) < 0)
+        return cosmoV_newNumber((cosmo_Number)a - (cosmo_Number)b);
+
+    return cosmoV_makeInteger(res);
+}
+
+static inline CValue cosmoV_mulInteger(cosmo_Integer a, cosmo_Integer b)
+{
+    bool overflow;
+
+    // the product of two 31 bit integers always fits in an int64_t
+    if (a >= -INT32_MAX && a <= INT32_MAX && b >= -INT32_MAX && b <= INT32_MAX)
+        return cosmoV_makeInteger(a * b);
+
+    if (a > 0)
+        overflow = b > 0 ? a > COSMO_INTEGER_MAX / b : b < COSMO_INTEGER_MIN / a;
+    else
+        overflow = b > 0 ? a < COSMO_INTEGER_MIN / b : (a != 0 && b < COSMO_INTEGER_MAX / a);
+
+    if (overflow)
+        return cosmoV_newNumber((cosmo_Number)a * (cosmo_Number)b);
+
+    return cosmoV_newInteger(a * b);
+}
+
+// reads an integer, or a double holding an exact integer value, into *out
+static inline bool cosmoV_asInteger(CValue val, cosmo_Integer *out)
+{
+    if (IS_INTEGER(val)) {
+        *out = cosmoV_readInteger(val);
+        return true;
+    }
+
+    if (IS_FLOAT(val)) {
+        cosmo_Number num = cosmoV_readFloat(val);
+
+        if (num >= -0x1p63 && num < 0x1p63 && num == (cosmo_Number)(cosmo_Integer)num) {
+            *out = (cosmo_Integer)num;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// '/' always results in a double
+static inline CValue cosmoV_divInteger(cosmo_Integer a, cosmo_Integer b)
+{
+    return cosmoV_newNumber((cosmo_Number)a / (cosmo_Number)b);
+}
+
+// used by the OP_INC* family, val must be a <number>
+static inline CValue cosmoV_incNumber(CValue val, int inc)
+{
+    if (IS_INTEGER(val))
+        return cosmoV_addInteger(cosmoV_readInteger(val), inc);
+
+    return cosmoV_newNumber(cosmoV_readFloat(val) + inc);
+}
+
 typedef CValue *StkPtr;
 
 struct CValueArray
@@ -119,6 +247,15 @@ void initValArray(CState *state, CValueArray *val, size_t startCapacity);
 void cleanValArray(CState *state, CValueArray *array); // cleans array
 void appendValArray(CState *state, CValueArray *array, CValue val);
 
+// big enough for any <number> written by cosmoV_numberToStr()
+#define COSMO_NUMBER_BUFSZ 32
+
+// writes val (a <number>) to buf like tostring() would & returns the length, buf must hold at least
+// COSMO_NUMBER_BUFSZ characters
+int cosmoV_numberToStr(CValue val, char *buf);
+// parses a number from the start of str, same as strtod() but much faster for plain decimals
+cosmo_Number cosmoV_strToNumber(const char *str);
+
 void cosmoV_printValue(CValue val);
 COSMO_API bool cosmoV_equal(CState *state, CValue valA, CValue valB);
 COSMO_API CObjString *cosmoV_toString(CState *state, CValue val);
@@ -1,6 +1,7 @@
 #include "cvm.h"
 
 #include "cdebug.h"
+#include "cjit.h"
 #include "cmem.h"
 #include "cparse.h"
 #include "cstate.h"
@@ -10,8 +11,6 @@
 #include <stdarg.h>
 #include <string.h>
 
-#define cosmoV_protect(panic) setjmp(panic->jmp) == 0
-
 void cosmoV_pushFString(CState *state, const char *format, ...)
 {
     va_list args;
@@ -37,20 +36,28 @@ void cosmoV_insert(CState *state, int indx, CValue val)
 bool cosmoV_undump(CState *state, cosmo_Reader reader, const void *ud)
 {
     CObjFunction *func;
+    CPanic *panic = cosmoV_newPanic(state);
 
-    if (cosmoD_undump(state, reader, ud, &func)) {
-        return false;
-    };
+    // the dump is verified while it's read, a bad one throws an error which we catch here
+    if (cosmoV_protect(panic)) {
+        if (cosmoD_undump(state, reader, ud, &func))
+            cosmoV_error(state, "failed to read dump!");
 
-    // #ifdef VM_DEBUG
-    disasmChunk(&func->chunk, func->name ? func->name->str : UNNAMEDCHUNK, 0);
-    // #endif
+        cosmoV_freePanic(state);
 
-    // push function onto the stack so it doesn't it cleaned up by the GC, at the same stack
-    // location put our closure
-    cosmoV_pushRef(state, (CObj *)func);
-    *(cosmoV_getTop(state, 0)) = cosmoV_newRef(cosmoO_newClosure(state, func));
-    return true;
+        // #ifdef VM_DEBUG
+        disasmChunk(&func->chunk, func->name ? func->name->str : UNNAMEDCHUNK, 0);
+        // #endif
+
+        // push function onto the stack so it doesn't it cleaned up by the GC, at the same stack
+        // location put our closure
+        cosmoV_pushRef(state, (CObj *)func);
+        *(cosmoV_getTop(state, 0)) = cosmoV_newRef(cosmoO_newClosure(state, func));
+        return true;
+    }
+
+    cosmoV_freePanic(state);
+    return false;
 }
 
 // returns false if failed, error will be on the top of the stack. true if successful, closure will
@@ -86,7 +93,7 @@ void cosmoV_printBacktrace(CState *state, CObjError *err)
         CObjFunction *function = frame->closure->function;
         CChunk *chunk = &function->chunk;
 
-        int line = chunk->lineInfo[frame->pc - chunk->buf - 1];
+        int line = getLineChunk(chunk, frame->pc - chunk->buf - 1);
 
         if (i == err->frameCount - 1 &&
             !err->parserError) // it's the last call frame (and not a parser error), prepare for the
@@ -111,6 +118,18 @@ void cosmoV_printBacktrace(CState *state, CObjError *err)
     printf("\t%.*s\n", errString->length, errString->str);
 }
 
+static void closeUpvalues(CCallFrame *frame, CValue *local)
+{
+    while (frame->openUpvalues != NULL &&
+           frame->openUpvalues->val >=
+               local) { // for every upvalue that points to the local or anything above it
+        CObjUpval *upvalue = frame->openUpvalues;
+        upvalue->closed = *upvalue->val;
+        upvalue->val = &upvalue->closed; // upvalue now points to itself :P
+        frame->openUpvalues = upvalue->next;
+    }
+}
+
 /*
     takes value on top of the stack and wraps an CObjError around it, then throws it
 */
@@ -121,6 +140,11 @@ void cosmoV_throw(CState *state)
 
     CValue val = cosmoV_newRef((CObj *)cosmoO_newError(state, *temp));
     if (state->panic) {
+        // close any upvalues still open in the frames we're unwinding
+        for (int i = state->frameCount - 1; i >= state->panic->frameCount; i--) {
+            closeUpvalues(&state->callFrame[i], state->callFrame[i].base);
+        }
+
         state->top = state->panic->top;
         state->frameCount = state->panic->frameCount;
         state->freezeGC = state->panic->freezeGC;
@@ -146,10 +170,13 @@ void cosmoV_error(CState *state, const char *format, ...)
     cosmoV_throw(state);
 }
 
-CObjUpval *captureUpvalue(CState *state, CValue *local)
+// each frame keeps its own list of open upvalues (sorted by stack slot, highest first), so
+// capturing & closing only ever walks the upvalues of the current frame and frames without captured
+// locals pay nothing on return
+static CObjUpval *captureUpvalue(CState *state, CCallFrame *frame, CValue *local)
 {
     CObjUpval *prev = NULL;
-    CObjUpval *upvalue = state->openUpvalues;
+    CObjUpval *upvalue = frame->openUpvalues;
 
     while (upvalue != NULL &&
            upvalue->val > local) { // while upvalue exists and is higher on the stack than local
@@ -166,7 +193,7 @@ CObjUpval *captureUpvalue(CState *state, CValue *local)
 
     // the list is sorted, so insert it at our found upvalue
     if (prev == NULL) {
-        state->openUpvalues = newUpval;
+        frame->openUpvalues = newUpval;
     } else {
         prev->next = newUpval;
     }
@@ -174,39 +201,36 @@ CObjUpval *captureUpvalue(CState *state, CValue *local)
     return newUpval;
 }
 
-void closeUpvalues(CState *state, CValue *local)
+void cosmoV_checkStack(CState *state, int needed)
 {
-    while (state->openUpvalues != NULL &&
-           state->openUpvalues->val >=
-               local) { // for every upvalue that points to the local or anything above it
-        CObjUpval *upvalue = state->openUpvalues;
-        upvalue->closed = *upvalue->val;
-        upvalue->val = &upvalue->closed; // upvalue now points to itself :P
-        state->openUpvalues = upvalue->next;
-    }
+    if (state->top + needed > state->stack + STACK_MAX - STACK_EXTRA)
+        cosmoV_error(state, "Stack overflow!");
 }
 
+// this is the only stack check a cosmo function gets, pushes inside of it are never checked
 void pushCallFrame(CState *state, CObjClosure *closure, int args)
 {
-#ifdef SAFE_STACK
     if (state->frameCount >= FRAME_MAX) {
         cosmoV_error(state, "Callframe overflow!");
         return;
     }
-#endif
+
+    // the closure & its arguments are already on the stack
+    cosmoV_checkStack(state, closure->function->maxStack - args - 1);
 
     CCallFrame *frame = &state->callFrame[state->frameCount++];
     frame->base = state->top - args - 1; // - 1 for the function
     frame->pc = closure->function->chunk.buf;
     frame->closure = closure;
+    frame->openUpvalues = NULL;
 }
 
 // offset is the offset of the callframe base we set the state->top back too (useful for passing
 // values in the stack as arguments, like methods)
 void popCallFrame(CState *state, int offset)
 {
-    closeUpvalues(state,
-                  state->callFrame[state->frameCount - 1].base); // close any upvalue still open
+    CCallFrame *frame = &state->callFrame[state->frameCount - 1];
+    closeUpvalues(frame, frame->base); // close any upvalue still open
 
     state->top = state->callFrame[state->frameCount - 1].base + offset; // resets the stack
     state->frameCount--;
@@ -216,25 +240,40 @@ void cosmoV_concat(CState *state, int vals)
 {
     StkPtr start = state->top - vals;
     StkPtr end = cosmoV_getTop(state, 0);
+    char numBuf[COSMO_NUMBER_BUFSZ];
+    size_t sz = 0;
+
+    // anything that isn't a string or a <number> is converted in place so our GC can still find it,
+    // numbers are written straight into the result instead of being interned on their own
+    for (StkPtr current = start; current <= end; current++) {
+        if (IS_NUMBER(*current)) {
+            sz += cosmoV_numberToStr(*current, numBuf);
+            continue;
+        }
 
-    CObjString *result = cosmoV_toString(state, *start);
-    for (StkPtr current = start + 1; current <= end; current++) {
-        cosmoV_pushRef(state, (CObj *)result); // so our GC can find our current result string
-        CObjString *otherStr = cosmoV_toString(state, *current);
-        cosmoV_pushRef(state, (CObj *)otherStr); // also so our GC won't free otherStr
+        if (!IS_STRING(*current))
+            *current = cosmoV_newRef((CObj *)cosmoV_toString(state, *current));
 
-        // concat the two strings together
-        size_t sz = result->length + otherStr->length;
-        char *buf = cosmoM_xmalloc(state, sz + 1); // +1 for null terminator
+        sz += cosmoV_readString(*current)->length;
+    }
 
-        memcpy(buf, result->str, result->length);
-        memcpy(buf + result->length, otherStr->str, otherStr->length);
-        buf[sz] = '\0';
-        result = cosmoO_takeString(state, buf, sz);
+    // concat everything in one go
+    CObjString *result = cosmoO_newStringBuffer(state, sz);
+    char *buf = result->str;
 
-        cosmoV_setTop(state, 2); // pop result & otherStr off the stack
+    for (StkPtr current = start; current <= end; current++) {
+        if (IS_NUMBER(*current)) {
+            int len = cosmoV_numberToStr(*current, numBuf);
+            memcpy(buf, numBuf, len);
+            buf += len;
+        } else {
+            CObjString *str = cosmoV_readString(*current);
+            memcpy(buf, str->str, str->length);
+            buf += str->length;
+        }
     }
 
+    result = cosmoO_internString(state, result);
     state->top = start;
     cosmoV_pushRef(state, (CObj *)result);
 }
@@ -253,6 +292,8 @@ static void callCFunction(CState *state, CosmoCFunction cfunc, int args, int nre
 {
     StkPtr savedBase = cosmoV_getTop(state, args);
 
+    // C functions can push up to STACK_EXTRA values without checking
+    cosmoV_checkStack(state, STACK_EXTRA);
     int nres = cfunc(state, args, savedBase + 1);
 
     // caller function wasn't expecting this many return values, cap it
@@ -290,9 +331,11 @@ static void rawCall(CState *state, CObjClosure *closure, int args, int nresults,
         int extraArgs = args - func->args;
         StkPtr variStart = cosmoV_getTop(state, extraArgs - 1);
 
+        cosmoV_checkStack(state, extraArgs * 2);
+
         // push key & value pairs
         for (int i = 0; i < extraArgs; i++) {
-            cosmoV_pushNumber(state, i);
+            cosmoV_pushInteger(state, i);
             cosmoV_pushValue(state, *(variStart + i));
         }
 
@@ -311,7 +354,14 @@ static void rawCall(CState *state, CObjClosure *closure, int args, int nresults,
     }
 
     // execute
-    int nres = cosmoV_execute(state);
+#ifdef COSMO_JIT
+    if (func->native == NULL && ++func->calls == COSMOJ_THRESHOLD)
+        cosmoJ_compile(state, func);
+#endif
+
+    int nres = func->native != NULL
+                   ? func->native(state, &state->callFrame[state->frameCount - 1])
+                   : cosmoV_execute(state);
 
     if (nres > nresults) // caller function wasn't expecting this many return values, cap it
         nres = nresults;
@@ -446,7 +496,7 @@ static inline bool isFalsey(StkPtr val)
 CObjObject *cosmoV_makeObject(CState *state, int pairs)
 {
     StkPtr key, val;
-    CObjObject *newObj = cosmoO_newObject(state);
+    CObjObject *newObj = cosmoO_newObjectSized(state, pairs);
     cosmoV_pushRef(state, (CObj *)newObj); // so our GC doesn't free our new object
 
     for (int i = 0; i < pairs; i++) {
@@ -476,7 +526,7 @@ bool cosmoV_registerProtoObject(CState *state, CObjType objType, CObjObject *obj
         if (curr != (CObj *)obj && curr->type == objType && curr->proto != NULL) {
             curr->proto = obj;
         }
-        curr = curr->next;
+        curr = cosmoO_readNext(curr);
     }
 
     return replaced;
@@ -485,7 +535,7 @@ bool cosmoV_registerProtoObject(CState *state, CObjType objType, CObjObject *obj
 void cosmoV_makeTable(CState *state, int pairs)
 {
     StkPtr key, val;
-    CObjTable *newObj = cosmoO_newTable(state);
+    CObjTable *newObj = cosmoO_newTableSized(state, pairs);
     cosmoV_pushRef(state, (CObj *)newObj); // so our GC doesn't free our new table
 
     for (int i = 0; i < pairs; i++) {
@@ -623,13 +673,15 @@ int _tbl__next(CState *state, int nargs, CValue *args)
 
     // while the entry is invalid, go to the next entry
     int cap = cosmoT_getCapacity(&table->tbl);
-    CTableEntry *entry;
-    do {
+    CTableEntry *entry = NULL;
+    while (index < cap) {
         entry = &table->tbl.table[index++];
-    } while (IS_NIL(entry->key) && index < cap);
+        if (!IS_NIL(entry->key))
+            break;
+    }
     cosmoO_setUserI(obj, index); // update the userdata
 
-    if (index < cap &&
+    if (entry != NULL &&
         !IS_NIL(entry->key)) { // if the entry is valid, return it's key and value pair
         cosmoV_pushValue(state, entry->key);
         cosmoV_pushValue(state, entry->val);
@@ -639,18 +691,89 @@ int _tbl__next(CState *state, int nargs, CValue *args)
     }
 }
 
-#define NUMBEROP(typeConst, op)                                                                    \
+// valA op valB, intOp(a, b) is used if both are integers, otherwise they're both read as doubles
+#define ARITH(intOp, op)                                                                           \
+    (IS_INTEGER(*valA) && IS_INTEGER(*valB)                                                        \
+         ? intOp(cosmoV_readInteger(*valA), cosmoV_readInteger(*valB))                             \
+         : cosmoV_newNumber(cosmoV_readNumber(*valA) op cosmoV_readNumber(*valB)))
+
+#define COMPARE(op)                                                                                \
+    cosmoV_newBoolean(IS_INTEGER(*valA) && IS_INTEGER(*valB)                                       \
+                          ? cosmoV_readInteger(*valA) op cosmoV_readInteger(*valB)                 \
+                          : cosmoV_readNumber(*valA) op cosmoV_readNumber(*valB))
+
+// shifts are logical over the integer width (COSMO_INTEGER_MASK), anything shifted 64 or more bits
+// away is 0 & negative shifts go the other way
+static inline cosmo_Integer shiftLeft(cosmo_Integer a, cosmo_Integer b)
+{
+    if (b <= -64 || b >= 64)
+        return 0;
+
+    uint64_t bits = (uint64_t)a & COSMO_INTEGER_MASK;
+    return (cosmo_Integer)(b >= 0 ? bits << b : bits >> -b);
+}
+
+static inline cosmo_Integer shiftRight(cosmo_Integer a, cosmo_Integer b)
+{
+    if (b <= -64 || b >= 64)
+        return 0;
+
+    uint64_t bits = (uint64_t)a & COSMO_INTEGER_MASK;
+    return (cosmo_Integer)(b >= 0 ? bits >> b : bits << -b);
+}
+
+// result is an expression of the integers a & b, doubles holding an exact integer are accepted too.
+// cosmoV_newInteger() wraps the result to the integer width so it always stays an integer
+#define BITWISEOP(result)                                                                          \
+    StkPtr valA = cosmoV_getTop(state, 1);                                                         \
+    StkPtr valB = cosmoV_getTop(state, 0);                                                         \
+    cosmo_Integer a, b;                                                                            \
+    if (cosmoV_asInteger(*valA, &a) && cosmoV_asInteger(*valB, &b)) {                              \
+        *valA = cosmoV_newInteger(result);                                                         \
+        state->top--;                                                                              \
+    } else if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {                                             \
+        cosmoV_error(state, "Number has no integer representation!");                              \
+    } else {                                                                                       \
+        cosmoV_error(state, "Expected numbers, got %s and %s!", cosmoV_typeStr(*valA),             \
+                     cosmoV_typeStr(*valB));                                                       \
+    }
+
+// result is ARITH() or COMPARE(). when both operands are integers or both are doubles the
+// instruction is quickened to the variant for that type, mixed operands stay generic
+#define NUMBEROP(result, intQuick, floatQuick)                                                     \
     StkPtr valA = cosmoV_getTop(state, 1);                                                         \
     StkPtr valB = cosmoV_getTop(state, 0);                                                         \
     if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {                                                    \
-        cosmoV_setTop(state, 2); /* pop the 2 values */                                            \
-        cosmoV_pushValue(state, typeConst(cosmoV_readNumber(*valA) op cosmoV_readNumber(*valB)));  \
+        if (IS_INTEGER(*valA) && IS_INTEGER(*valB)) {                                              \
+            QUICKEN(intQuick);                                                                     \
+        } else if (IS_FLOAT(*valA) && IS_FLOAT(*valB)) {                                           \
+            QUICKEN(floatQuick);                                                                   \
+        }                                                                                          \
+        *valA = result;                                                                            \
+        state->top--;                                                                              \
     } else {                                                                                       \
         cosmoV_error(state, "Expected numbers, got %s and %s!", cosmoV_typeStr(*valA),             \
                      cosmoV_typeStr(*valB));                                                       \
         return -1;                                                                                 \
     }
 
+// the quickened variants of NUMBEROP, each guards on a single type & reads the operands directly.
+// if the guard fails the instruction is rewritten back to the generic opcode and re-executed
+#define INTARITH(intOp)  intOp(cosmoV_readInteger(*valA), cosmoV_readInteger(*valB))
+#define INTCOMPARE(op)   cosmoV_newBoolean(cosmoV_readInteger(*valA) op cosmoV_readInteger(*valB))
+#define FLOATARITH(op)   cosmoV_newNumber(cosmoV_readFloat(*valA) op cosmoV_readFloat(*valB))
+#define FLOATCOMPARE(op) cosmoV_newBoolean(cosmoV_readFloat(*valA) op cosmoV_readFloat(*valB))
+
+#define QUICKOP(guard, result, generic)                                                            \
+    StkPtr valA = cosmoV_getTop(state, 1);                                                         \
+    StkPtr valB = cosmoV_getTop(state, 0);                                                         \
+    if (guard(*valA) && guard(*valB)) {                                                            \
+        *valA = result;                                                                            \
+        state->top--;                                                                              \
+    } else {                                                                                       \
+        UNQUICKEN(generic);                                                                        \
+    }
+
 static inline uint8_t READBYTE(CCallFrame *frame)
 {
     return *frame->pc++;
@@ -662,13 +785,203 @@ static inline uint16_t READUINT(CCallFrame *frame)
     return *(uint16_t *)(&frame->pc[-2]);
 }
 
-#ifdef VM_JUMPTABLE
-#    define DISPATCH goto *cosmoV_dispatchTable[READBYTE(frame)]
+/*
+    globals are cached per function as a slot index into the globals table for each identifier
+    constant. a slot is only trusted if the entry at that index still holds the identifier, so
+    resizing, removing keys or swapping out vm.globals all fall back to resolveGlobal
+*/
+static inline CValue *getGlobalSlot(CState *state, CObjFunction *func, uint16_t indx)
+{
+    CTable *tbl = &state->globals->tbl;
+
+    if (func->globalSlots != NULL) {
+        int slot = func->globalSlots[indx];
+        if (slot <= tbl->capacityMask) {
+            CTableEntry *entry = &tbl->table[slot];
+            if (IS_REF(entry->key) &&
+                cosmoV_readRef(entry->key) == cosmoV_readRef(func->chunk.constants.values[indx]))
+                return &entry->val;
+        }
+    }
+
+    return NULL;
+}
+
+// looks up (or defines) the global & caches its slot, returns NULL if it isn't defined
+static CValue *resolveGlobal(CState *state, CObjFunction *func, uint16_t indx, bool define)
+{
+    CTable *tbl;
+    CValue ident = func->chunk.constants.values[indx];
+    int slot;
+
+    // allocate the cache first, since this might trigger a GC
+    if (func->globalSlots == NULL) {
+        int count = func->chunk.constants.count;
+        func->globalSlots = cosmoM_xmalloc(state, sizeof(int) * count);
+        memset(func->globalSlots, 0, sizeof(int) * count);
+    }
+
+    tbl = &state->globals->tbl;
+    if (define)
+        cosmoT_insert(state, tbl, ident);
+
+    if ((slot = cosmoT_getSlot(state, tbl, ident)) == -1)
+        return NULL;
+
+    func->globalSlots[indx] = slot;
+    return &tbl->table[slot].val;
+}
+
+#ifdef VM_THREADED
+// builds func->threaded, handlers is the dispatch table of the loop that's going to run it
+static void threadFunction(CState *state, CObjFunction *func, const void **handlers)
+{
+    CChunk *chunk = &func->chunk;
+    CThreadedSlot *threaded = cosmoM_xmalloc(state, sizeof(CThreadedSlot) * chunk->count);
+
+    for (int offset = 0; offset < chunk->count;) {
+        int size = instrSizeChunk(chunk, offset);
+
+        // we don't know which operands are u8s & which are u16s, so every operand slot gets both
+        threaded[offset].handler = handlers[chunk->buf[offset]];
+        for (int i = offset + 1; i < offset + size; i++) {
+            threaded[i].operand.u8 = chunk->buf[i];
+            threaded[i].operand.u16 = i + 1 < offset + size ? readu16Chunk(chunk, i) : 0;
+        }
+
+        offset += size;
+    }
+
+    func->threaded = threaded;
+}
+#endif
+
+/*
+    cosmoV_execute (& the VM_TAILCALL handlers) keep the instruction pointer & stack base in locals
+    so they can live in registers. frame->pc is still written after the opcode & each operand, so
+    errors, backtraces & calls see the same thing they would otherwise, it's just never read back.
+    only the JIT's back-edge hook moves frame->pc itself, hence SAVEPC() & LOADPC()
+*/
+#ifdef VM_THREADED
+/*
+    pc walks func->threaded instead, which has a slot for every byte of the chunk so offsets &
+    jumps line up with the byte buffer. frame->pc is only written once per instruction, pointing
+    just past its opcode (see PUREOP)
+*/
+#    define READBYTE(frame) ((pc++)->operand.u8)
+#    define READUINT(frame) (pc += 2, pc[-2].operand.u16)
+#    define SAVEPC()        frame->pc = code + (pc - threaded)
+#    define LOADPC()        pc = threaded + (frame->pc - code)
+#    define QUICKEN(op)     pc[-1].handler = cosmoV_dispatchTable[op]
+#    define UNQUICKEN(op)   (--pc)->handler = cosmoV_dispatchTable[op]
+#else
+#    define READBYTE(frame) (frame->pc = pc + 1, *pc++)
+#    define READUINT(frame) (pc += 2, frame->pc = pc, *(uint16_t *)&pc[-2])
+#    define SAVEPC()        frame->pc = pc
+#    define LOADPC()        pc = frame->pc
+#    define QUICKEN(op)     PC[-1] = op
+#    define UNQUICKEN(op)   *(--PC) = op
+#endif
+#define PC   pc
+#define BASE base
+
+#ifdef VM_TAILCALL
+typedef int (*CosmoHandler)(CState *state, CCallFrame *frame, INSTRUCTION *pc, StkPtr base,
+                            CValue *constants);
+
+static const CosmoHandler cosmoV_handlers[256];
+
+// every opcode body in cvmops.h becomes its own handler, which ends by tail calling the handler
+// for the next instruction with pc, base & constants passed along in registers
+#    define DISPATCH                                                                               \
+        COSMO_MUSTTAIL return cosmoV_handlers[*pc](state, frame, pc + 1, base, constants)
 #    define CASE(op)                                                                               \
         DISPATCH;                                                                                  \
-        JMP_##op
+        }                                                                                          \
+        static int HANDLER_##op(CState *state, CCallFrame *frame, INSTRUCTION *pc, StkPtr base,    \
+                                CValue *constants)                                                 \
+        {                                                                                          \
+            frame->pc = pc;                                                                        \
+            switch (0)                                                                             \
+            default
+#    define HANDLER(op) [op] = HANDLER_##op
+
+// the first CASE in cvmops.h closes this function, leaving just the dispatch to the first handler
+static int cosmoV_dispatch(CState *state, CCallFrame *frame, INSTRUCTION *pc, StkPtr base,
+                           CValue *constants)
+{
+#    include "cvmops.h"
+    DISPATCH;
+}
+
+static const CosmoHandler cosmoV_handlers[256] = {
+    HANDLER(OP_LOADCONST),     HANDLER(OP_SETGLOBAL),     HANDLER(OP_GETGLOBAL),
+    HANDLER(OP_SETLOCAL),      HANDLER(OP_GETLOCAL),      HANDLER(OP_GETUPVAL),
+    HANDLER(OP_SETUPVAL),      HANDLER(OP_PEJMP),         HANDLER(OP_EJMP),
+    HANDLER(OP_JMP),           HANDLER(OP_JMPBACK),       HANDLER(OP_POP),
+    HANDLER(OP_CALL),          HANDLER(OP_CLOSURE),       HANDLER(OP_CLOSE),
+    HANDLER(OP_NEWTABLE),      HANDLER(OP_NEWARRAY),      HANDLER(OP_INDEX),
+    HANDLER(OP_NEWINDEX),      HANDLER(OP_NEWOBJECT),     HANDLER(OP_SETOBJECT),
+    HANDLER(OP_GETOBJECT),     HANDLER(OP_GETMETHOD),     HANDLER(OP_INVOKE),
+    HANDLER(OP_ITER),          HANDLER(OP_NEXT),          HANDLER(OP_ADD),
+    HANDLER(OP_SUB),           HANDLER(OP_MULT),          HANDLER(OP_DIV),
+    HANDLER(OP_MOD),           HANDLER(OP_POW),           HANDLER(OP_IDIV),
+    HANDLER(OP_BAND),          HANDLER(OP_BOR),           HANDLER(OP_BXOR),
+    HANDLER(OP_SHL),           HANDLER(OP_SHR),           HANDLER(OP_BNOT),
+    HANDLER(OP_NOT),           HANDLER(OP_NEGATE),        HANDLER(OP_COUNT),
+    HANDLER(OP_CONCAT),        HANDLER(OP_INCLOCAL),      HANDLER(OP_INCGLOBAL),
+    HANDLER(OP_INCUPVAL),      HANDLER(OP_INCINDEX),      HANDLER(OP_INCOBJECT),
+    HANDLER(OP_EQUAL),         HANDLER(OP_LESS),          HANDLER(OP_GREATER),
+    HANDLER(OP_LESS_EQUAL),    HANDLER(OP_GREATER_EQUAL), HANDLER(OP_TRUE),
+    HANDLER(OP_FALSE),         HANDLER(OP_NIL),           HANDLER(OP_RETURN),
+    HANDLER(OP_ADD_INT), HANDLER(OP_SUB_INT), HANDLER(OP_MULT_INT), HANDLER(OP_DIV_INT),
+    HANDLER(OP_LESS_INT), HANDLER(OP_GREATER_INT), HANDLER(OP_LESS_EQUAL_INT),
+    HANDLER(OP_GREATER_EQUAL_INT), HANDLER(OP_ADD_FLOAT), HANDLER(OP_SUB_FLOAT),
+    HANDLER(OP_MULT_FLOAT), HANDLER(OP_DIV_FLOAT), HANDLER(OP_LESS_FLOAT),
+    HANDLER(OP_GREATER_FLOAT), HANDLER(OP_LESS_EQUAL_FLOAT), HANDLER(OP_GREATER_EQUAL_FLOAT),
+    HANDLER(OP_INDEX_TBL),
+};
+
+// returns -1 if panic
+int cosmoV_execute(CState *state)
+{
+    CCallFrame *frame = &state->callFrame[state->frameCount - 1];
+
+    return cosmoV_dispatch(state, frame, frame->pc, frame->base,
+                           frame->closure->function->chunk.constants.values);
+}
+#elif defined(VM_JUMPTABLE)
+#    ifdef VM_THREADED
+// instructions that can't throw or call anything never need frame->pc, everything else writes it
+// before running
+#        define PUREOP(op)                                                                         \
+            (op == OP_LOADCONST || op == OP_GETLOCAL || op == OP_SETLOCAL || op == OP_GETUPVAL ||  \
+             op == OP_SETUPVAL || op == OP_PEJMP || op == OP_EJMP || op == OP_JMP ||               \
+             op == OP_JMPBACK || op == OP_POP || op == OP_CLOSE || op == OP_TRUE ||                \
+             op == OP_FALSE || op == OP_NIL || op == OP_RETURN || op == OP_ADD_INT ||              \
+             op == OP_SUB_INT || op == OP_MULT_INT || op == OP_DIV_INT || op == OP_LESS_INT ||     \
+             op == OP_GREATER_INT || op == OP_LESS_EQUAL_INT || op == OP_GREATER_EQUAL_INT ||      \
+             op == OP_ADD_FLOAT || op == OP_SUB_FLOAT || op == OP_MULT_FLOAT ||                    \
+             op == OP_DIV_FLOAT || op == OP_LESS_FLOAT || op == OP_GREATER_FLOAT ||                \
+             op == OP_LESS_EQUAL_FLOAT || op == OP_GREATER_EQUAL_FLOAT)
+#        define DISPATCH goto *(pc++)->handler
+#        define CASE(op)                                                                           \
+            DISPATCH;                                                                              \
+            JMP_##op : if (!PUREOP(op)) SAVEPC();                                                  \
+            switch (0)                                                                             \
+            default
+#        define SWITCH DISPATCH;
+#    else
+#        define DISPATCH goto *cosmoV_dispatchTable[READBYTE(frame)]
+#        define CASE(op)                                                                           \
+            DISPATCH;                                                                              \
+            JMP_##op
+#        define SWITCH                                                                             \
+            DISPATCHTABLE;                                                                         \
+            DISPATCH;
+#    endif
 #    define JMPLABEL(op) &&JMP_##op
-#    define SWITCH                                                                                 \
+#    define DISPATCHTABLE                                                                          \
         static void *cosmoV_dispatchTable[] = {                                                    \
             JMPLABEL(OP_LOADCONST),     JMPLABEL(OP_SETGLOBAL), JMPLABEL(OP_GETGLOBAL),            \
             JMPLABEL(OP_SETLOCAL),      JMPLABEL(OP_GETLOCAL),  JMPLABEL(OP_GETUPVAL),             \
@@ -680,15 +993,22 @@ static inline uint16_t READUINT(CCallFrame *frame)
             JMPLABEL(OP_GETOBJECT),     JMPLABEL(OP_GETMETHOD), JMPLABEL(OP_INVOKE),               \
             JMPLABEL(OP_ITER),          JMPLABEL(OP_NEXT),      JMPLABEL(OP_ADD),                  \
             JMPLABEL(OP_SUB),           JMPLABEL(OP_MULT),      JMPLABEL(OP_DIV),                  \
-            JMPLABEL(OP_MOD),           JMPLABEL(OP_POW),       JMPLABEL(OP_NOT),                  \
-            JMPLABEL(OP_NEGATE),        JMPLABEL(OP_COUNT),     JMPLABEL(OP_CONCAT),               \
-            JMPLABEL(OP_INCLOCAL),      JMPLABEL(OP_INCGLOBAL), JMPLABEL(OP_INCUPVAL),             \
-            JMPLABEL(OP_INCINDEX),      JMPLABEL(OP_INCOBJECT), JMPLABEL(OP_EQUAL),                \
-            JMPLABEL(OP_LESS),          JMPLABEL(OP_GREATER),   JMPLABEL(OP_LESS_EQUAL),           \
-            JMPLABEL(OP_GREATER_EQUAL), JMPLABEL(OP_TRUE),      JMPLABEL(OP_FALSE),                \
-            JMPLABEL(OP_NIL),           JMPLABEL(OP_RETURN),                                       \
-        };                                                                                         \
-        DISPATCH;
+            JMPLABEL(OP_MOD),           JMPLABEL(OP_POW),       JMPLABEL(OP_IDIV),                 \
+            JMPLABEL(OP_BAND),          JMPLABEL(OP_BOR),       JMPLABEL(OP_BXOR),                 \
+            JMPLABEL(OP_SHL),           JMPLABEL(OP_SHR),       JMPLABEL(OP_BNOT),                 \
+            JMPLABEL(OP_NOT),           JMPLABEL(OP_NEGATE),    JMPLABEL(OP_COUNT),                \
+            JMPLABEL(OP_CONCAT),        JMPLABEL(OP_INCLOCAL),  JMPLABEL(OP_INCGLOBAL),            \
+            JMPLABEL(OP_INCUPVAL),      JMPLABEL(OP_INCINDEX),  JMPLABEL(OP_INCOBJECT),            \
+            JMPLABEL(OP_EQUAL),         JMPLABEL(OP_LESS),      JMPLABEL(OP_GREATER),              \
+            JMPLABEL(OP_LESS_EQUAL),    JMPLABEL(OP_GREATER_EQUAL), JMPLABEL(OP_TRUE),             \
+            JMPLABEL(OP_FALSE),         JMPLABEL(OP_NIL),       JMPLABEL(OP_RETURN),               \
+            JMPLABEL(OP_ADD_INT), JMPLABEL(OP_SUB_INT), JMPLABEL(OP_MULT_INT),                     \
+            JMPLABEL(OP_DIV_INT), JMPLABEL(OP_LESS_INT), JMPLABEL(OP_GREATER_INT),                 \
+            JMPLABEL(OP_LESS_EQUAL_INT), JMPLABEL(OP_GREATER_EQUAL_INT), JMPLABEL(OP_ADD_FLOAT),   \
+            JMPLABEL(OP_SUB_FLOAT), JMPLABEL(OP_MULT_FLOAT), JMPLABEL(OP_DIV_FLOAT),               \
+            JMPLABEL(OP_LESS_FLOAT), JMPLABEL(OP_GREATER_FLOAT), JMPLABEL(OP_LESS_EQUAL_FLOAT),    \
+            JMPLABEL(OP_GREATER_EQUAL_FLOAT), JMPLABEL(OP_INDEX_TBL),                              \
+        }
 #    define DEFAULT DISPATCH /* no-op */
 #else
 #    define CASE(op)                                                                               \
@@ -701,11 +1021,26 @@ static inline uint16_t READUINT(CCallFrame *frame)
         exit(0)
 #endif
 
+#ifndef VM_TAILCALL
 // returns -1 if panic
 int cosmoV_execute(CState *state)
 {
     CCallFrame *frame = &state->callFrame[state->frameCount - 1];         // grabs the current frame
     CValue *constants = frame->closure->function->chunk.constants.values; // cache the pointer :)
+    StkPtr base = frame->base;
+#ifdef VM_THREADED
+    DISPATCHTABLE;
+    CObjFunction *func = frame->closure->function;
+    INSTRUCTION *code = func->chunk.buf;
+
+    if (func->threaded == NULL)
+        threadFunction(state, func, (const void **)cosmoV_dispatchTable);
+
+    CThreadedSlot *threaded = func->threaded;
+    CThreadedSlot *pc = threaded + (frame->pc - code);
+#else
+    INSTRUCTION *pc = frame->pc;
+#endif
 
     for (;;) {
 #ifdef VM_DEBUG
@@ -716,586 +1051,55 @@ int cosmoV_execute(CState *state)
 #endif
         SWITCH
         {
-            CASE(OP_LOADCONST) :
-            { // push const[uint] to stack
-                uint16_t indx = READUINT(frame);
-                cosmoV_pushValue(state, constants[indx]);
-            }
-            CASE(OP_SETGLOBAL) :
-            {
-                uint16_t indx = READUINT(frame);
-                CValue ident = constants[indx]; // grabs identifier
-                CValue *val = cosmoT_insert(state, &state->globals->tbl, ident);
-                *val = *cosmoV_pop(state); // sets the value in the hash table
-            }
-            CASE(OP_GETGLOBAL) :
-            {
-                uint16_t indx = READUINT(frame);
-                CValue ident = constants[indx]; // grabs identifier
-                CValue val;                     // to hold our value
-                cosmoT_get(state, &state->globals->tbl, ident, &val);
-                cosmoV_pushValue(state, val); // pushes the value to the stack
-            }
-            CASE(OP_SETLOCAL) :
-            {
-                uint8_t indx = READBYTE(frame);
-                // set base to top of stack & pop
-                frame->base[indx] = *cosmoV_pop(state);
-            }
-            CASE(OP_GETLOCAL) :
-            {
-                uint8_t indx = READBYTE(frame);
-                cosmoV_pushValue(state, frame->base[indx]);
-            }
-            CASE(OP_GETUPVAL) :
-            {
-                uint8_t indx = READBYTE(frame);
-                cosmoV_pushValue(state, *frame->closure->upvalues[indx]->val);
-            }
-            CASE(OP_SETUPVAL) :
-            {
-                uint8_t indx = READBYTE(frame);
-                *frame->closure->upvalues[indx]->val = *cosmoV_pop(state);
-            }
-            CASE(OP_PEJMP) :
-            { // pop equality jump
-                uint16_t offset = READUINT(frame);
-
-                if (isFalsey(cosmoV_pop(state))) { // pop, if the condition is false, jump!
-                    frame->pc += offset;
-                }
-            }
-            CASE(OP_EJMP) :
-            { // equality jump
-                uint16_t offset = READUINT(frame);
+#include "cvmops.h"
+            DEFAULT;
+        }
+    }
 
-                if (isFalsey(cosmoV_getTop(state, 0))) { // if the condition is false, jump!
-                    frame->pc += offset;
-                }
-            }
-            CASE(OP_JMP) :
-            { // jump
-                uint16_t offset = READUINT(frame);
-                frame->pc += offset;
-            }
-            CASE(OP_JMPBACK) :
-            {
-                uint16_t offset = READUINT(frame);
-                frame->pc -= offset;
-            }
-            CASE(OP_POP) :
-            { // pops value off the stack
-                cosmoV_setTop(state, READBYTE(frame));
-            }
-            CASE(OP_CALL) :
-            {
-                uint8_t args = READBYTE(frame);
-                uint8_t nres = READBYTE(frame);
-                cosmoV_call(state, args, nres);
-            }
-            CASE(OP_CLOSURE) :
-            {
-                uint16_t index = READUINT(frame);
-                CObjFunction *func = cosmoV_readFunction(constants[index]);
-                CObjClosure *closure = cosmoO_newClosure(state, func);
-                cosmoV_pushRef(state, (CObj *)closure);
-
-                for (int i = 0; i < closure->upvalueCount; i++) {
-                    uint8_t encoding = READBYTE(frame);
-                    uint8_t index = READBYTE(frame);
-                    if (encoding == OP_GETUPVAL) {
-                        // capture upvalue from current frame's closure
-                        closure->upvalues[i] = frame->closure->upvalues[index];
-                    } else {
-                        // capture local
-                        closure->upvalues[i] = captureUpvalue(state, frame->base + index);
-                    }
-                }
-            }
-            CASE(OP_CLOSE) :
-            {
-                closeUpvalues(state, state->top - 1);
-                cosmoV_pop(state);
-            }
-            CASE(OP_NEWTABLE) :
-            {
-                uint16_t pairs = READUINT(frame);
-                cosmoV_makeTable(state, pairs);
-            }
-            CASE(OP_NEWARRAY) :
-            {
-                uint16_t pairs = READUINT(frame);
-                StkPtr val;
-                CObjTable *newObj = cosmoO_newTable(state);
-                cosmoV_pushRef(state, (CObj *)newObj); // so our GC doesn't free our new table
-
-                for (int i = 0; i < pairs; i++) {
-                    val = cosmoV_getTop(state, i + 1);
-
-                    // set key/value pair
-                    CValue *newVal =
-                        cosmoT_insert(state, &newObj->tbl, cosmoV_newNumber(pairs - i - 1));
-                    *newVal = *val;
-                }
-
-                // once done, pop everything off the stack + push new table
-                cosmoV_setTop(state, pairs + 1); // + 1 for our table
-                cosmoV_pushRef(state, (CObj *)newObj);
-            }
-            CASE(OP_INDEX) :
-            {
-                StkPtr key = cosmoV_getTop(state, 0);  // key should be the top of the stack
-                StkPtr temp = cosmoV_getTop(state, 1); // after that should be the table
-
-                // sanity check
-                if (!IS_REF(*temp)) {
-                    cosmoV_error(state, "Couldn't index type %s!", cosmoV_typeStr(*temp));
-                }
-
-                CObj *obj = cosmoV_readRef(*temp);
-                CObjObject *proto = cosmoO_grabProto(obj);
-                CValue val = cosmoV_newNil(); // to hold our value
-
-                if (proto != NULL) {
-                    // check for __index metamethod
-                    cosmoO_indexObject(state, proto, *key, &val);
-                } else if (obj->type == COBJ_TABLE) {
-                    CObjTable *tbl = (CObjTable *)obj;
-
-                    cosmoT_get(state, &tbl->tbl, *key, &val);
-                } else {
-                    cosmoV_error(state, "No proto defined! Couldn't __index from type %s",
-                                 cosmoV_typeStr(*temp));
-                }
-
-                cosmoV_setTop(state, 2);      // pops the table & the key
-                cosmoV_pushValue(state, val); // pushes the field result
-            }
-            CASE(OP_NEWINDEX) :
-            {
-                StkPtr value = cosmoV_getTop(state, 0); // value is at the top of the stack
-                StkPtr key = cosmoV_getTop(state, 1);
-                StkPtr temp = cosmoV_getTop(state, 2); // table is after the key
-
-                // sanity check
-                if (!IS_REF(*temp)) {
-                    cosmoV_error(state, "Couldn't set index with type %s!", cosmoV_typeStr(*temp));
-                }
-
-                CObj *obj = cosmoV_readRef(*temp);
-                CObjObject *proto = cosmoO_grabProto(obj);
-
-                if (proto != NULL) {
-                    cosmoO_newIndexObject(state, proto, *key, *value);
-                } else if (obj->type == COBJ_TABLE) {
-                    CObjTable *tbl = (CObjTable *)obj;
-                    CValue *newVal = cosmoT_insert(state, &tbl->tbl, *key);
-
-                    *newVal = *value; // set the index
-                } else {
-                    cosmoV_error(state, "No proto defined! Couldn't __newindex from type %s",
-                                 cosmoV_typeStr(*temp));
-                }
-
-                // pop everything off the stack
-                cosmoV_setTop(state, 3);
-            }
-            CASE(OP_NEWOBJECT) :
-            {
-                uint16_t pairs = READUINT(frame);
-                cosmoV_makeObject(state, pairs);
-            }
-            CASE(OP_SETOBJECT) :
-            {
-                StkPtr value = cosmoV_getTop(state, 0); // value is at the top of the stack
-                StkPtr temp = cosmoV_getTop(state, 1);  // object is after the value
-                uint16_t ident = READUINT(frame);       // use for the key
-
-                // sanity check
-                if (IS_REF(*temp)) {
-                    cosmoV_rawset(state, cosmoV_readRef(*temp), constants[ident], *value);
-                } else {
-                    CObjString *field = cosmoV_toString(state, constants[ident]);
-                    cosmoV_error(state, "Couldn't set field '%s' on type %s!", field->str,
-                                 cosmoV_typeStr(*temp));
-                }
-
-                // pop everything off the stack
-                cosmoV_setTop(state, 2);
-            }
-            CASE(OP_GETOBJECT) :
-            {
-                CValue val = cosmoV_newNil();          // to hold our value
-                StkPtr temp = cosmoV_getTop(state, 0); // that should be the object
-                uint16_t ident = READUINT(frame);      // use for the key
-
-                // sanity check
-                if (IS_REF(*temp)) {
-                    cosmoV_rawget(state, cosmoV_readRef(*temp), constants[ident], &val);
-                } else {
-                    CObjString *field = cosmoV_toString(state, constants[ident]);
-                    cosmoV_error(state, "Couldn't get field '%s' from type %s!", field->str,
-                                 cosmoV_typeStr(*temp));
-                }
-
-                cosmoV_setTop(state, 1);      // pops the object
-                cosmoV_pushValue(state, val); // pushes the field result
-            }
-            CASE(OP_GETMETHOD) :
-            {
-                CValue val = cosmoV_newNil();          // to hold our value
-                StkPtr temp = cosmoV_getTop(state, 0); // that should be the object
-                uint16_t ident = READUINT(frame);      // use for the key
-
-                // this is almost identical to GETOBJECT, however cosmoV_getMethod is used instead
-                // of just cosmoV_get
-                if (IS_REF(*temp)) {
-                    cosmoV_getMethod(state, cosmoV_readRef(*temp), constants[ident], &val);
-                } else {
-                    CObjString *field = cosmoV_toString(state, constants[ident]);
-                    cosmoV_error(state, "Couldn't get field '%s' from type %s!", field->str,
-                                 cosmoV_typeStr(*temp));
-                }
-
-                cosmoV_setTop(state, 1);      // pops the object
-                cosmoV_pushValue(state, val); // pushes the field result
-            }
-            CASE(OP_INVOKE) :
-            {
-                uint8_t args = READBYTE(frame);
-                uint8_t nres = READBYTE(frame);
-                uint16_t ident = READUINT(frame);
-                StkPtr temp = cosmoV_getTop(state, args); // grabs object from stack
-                CValue val;                               // to hold our value
-
-                // sanity check
-                if (IS_REF(*temp)) {
-                    // get the field from the object
-                    cosmoV_rawget(state, cosmoV_readRef(*temp), constants[ident], &val);
-
-                    // now invoke the method!
-                    invokeMethod(state, cosmoV_readRef(*temp), val, args, nres, 1);
-                } else {
-                    cosmoV_error(state, "Couldn't get from type %s!", cosmoV_typeStr(*temp));
-                }
-            }
-            CASE(OP_ITER) :
-            {
-                StkPtr temp = cosmoV_getTop(state, 0); // should be the object/table
-
-                if (!IS_REF(*temp)) {
-                    cosmoV_error(state, "Couldn't iterate over non-iterator type %s!",
-                                 cosmoV_typeStr(*temp));
-                }
-
-                CObj *obj = cosmoV_readRef(*temp);
-                CObjObject *proto = cosmoO_grabProto(obj);
-                CValue val;
-
-                if (proto != NULL) {
-                    // grab __iter & call it
-                    if (cosmoO_getIString(state, proto, ISTRING_ITER, &val)) {
-                        cosmoV_pop(state); // pop the object from the stack
-                        cosmoV_pushValue(state, val);
-                        cosmoV_pushRef(state, (CObj *)obj);
-                        cosmoV_call(
-                            state, 1,
-                            1); // we expect 1 return value on the stack, the iterable object
-
-                        StkPtr iObj = cosmoV_getTop(state, 0);
-
-                        if (!IS_OBJECT(*iObj)) {
-                            cosmoV_error(state,
-                                         "Expected iterable object! '__iter' returned %s, expected "
-                                         "<object>!",
-                                         cosmoV_typeStr(*iObj));
-                        }
-
-                        // get __next method and place it at the top of the stack
-                        cosmoV_getMethod(state, cosmoV_readRef(*iObj),
-                                         cosmoV_newRef(state->iStrings[ISTRING_NEXT]), iObj);
-                    } else {
-                        cosmoV_error(state, "Expected iterable object! '__iter' not defined!");
-                    }
-                } else if (obj->type == COBJ_TABLE) {
-                    CObjTable *tbl = (CObjTable *)obj;
-
-                    cosmoV_pushRef(state, (CObj *)state->iStrings[ISTRING_RESERVED]); // key
-                    cosmoV_pushRef(state, (CObj *)tbl);                               // value
-
-                    cosmoV_pushString(state, "__next"); // key
-                    CObjCFunction *tbl_next = cosmoO_newCFunction(state, _tbl__next);
-                    cosmoV_pushRef(state, (CObj *)tbl_next); // value
-
-                    CObjObject *obj =
-                        cosmoV_makeObject(state, 2); // pushes the new object to the stack
-                    cosmoO_setUserI(obj, 0);         // increment for iterator
-
-                    // make our CObjMethod for OP_NEXT to call
-                    CObjMethod *method =
-                        cosmoO_newMethod(state, cosmoV_newRef(tbl_next), (CObj *)obj);
-
-                    cosmoV_setTop(state, 2);               // pops the object & the tbl
-                    cosmoV_pushRef(state, (CObj *)method); // pushes the method for OP_NEXT
-                } else {
-                    cosmoV_error(state, "No proto defined! Couldn't get from type %s",
-                                 cosmoO_typeStr(obj));
-                }
-            }
-            CASE(OP_NEXT) :
-            {
-                uint8_t nresults = READBYTE(frame);
-                uint16_t jump = READUINT(frame);
-                StkPtr temp = cosmoV_getTop(state, 0); // we don't actually pop this off the stack
-
-                if (!IS_METHOD(*temp)) {
-                    cosmoV_error(state, "Expected '__next' to be a method, got type %s!",
-                                 cosmoV_typeStr(*temp));
-                }
-
-                cosmoV_pushValue(state, *temp);
-                cosmoV_call(state, 0, nresults);
-
-                if (IS_NIL(*(cosmoV_getTop(
-                        state, 0)))) { // __next returned a nil, which means to exit the loop
-                    cosmoV_setTop(state, nresults); // pop the return values
-                    frame->pc += jump;
-                }
-            }
-            CASE(OP_ADD) :
-            {
-                // pop 2 values off the stack & try to add them together
-                NUMBEROP(cosmoV_newNumber, +);
-            }
-            CASE(OP_SUB) :
-            {
-                // pop 2 values off the stack & try to subtracts them
-                NUMBEROP(cosmoV_newNumber, -);
-            }
-            CASE(OP_MULT) :
-            {
-                // pop 2 values off the stack & try to multiplies them together
-                NUMBEROP(cosmoV_newNumber, *);
-            }
-            CASE(OP_DIV) :
-            {
-                // pop 2 values off the stack & try to divides them
-                NUMBEROP(cosmoV_newNumber, /);
-            }
-            CASE(OP_MOD) :
-            {
-                StkPtr valA = cosmoV_getTop(state, 1);
-                StkPtr valB = cosmoV_getTop(state, 0);
-                if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {
-                    cosmoV_setTop(state, 2); /* pop the 2 values */
-                    cosmoV_pushValue(state, cosmoV_newNumber(fmod(cosmoV_readNumber(*valA),
-                                                                  cosmoV_readNumber(*valB))));
-                } else {
-                    cosmoV_error(state, "Expected numbers, got %s and %s!", cosmoV_typeStr(*valA),
-                                 cosmoV_typeStr(*valB));
-                }
-            }
-            CASE(OP_POW) :
-            {
-                StkPtr valA = cosmoV_getTop(state, 1);
-                StkPtr valB = cosmoV_getTop(state, 0);
-                if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {
-                    cosmoV_setTop(state, 2); /* pop the 2 values */
-                    cosmoV_pushValue(state, cosmoV_newNumber(pow(cosmoV_readNumber(*valA),
-                                                                 cosmoV_readNumber(*valB))));
-                } else {
-                    cosmoV_error(state, "Expected numbers, got %s and %s!", cosmoV_typeStr(*valA),
-                                 cosmoV_typeStr(*valB));
-                }
-            }
-            CASE(OP_NOT) :
-            {
-                cosmoV_pushBoolean(state, isFalsey(cosmoV_pop(state)));
-            }
-            CASE(OP_NEGATE) :
-            { // pop 1 value off the stack & try to negate
-                StkPtr val = cosmoV_getTop(state, 0);
-
-                if (IS_NUMBER(*val)) {
-                    cosmoV_pop(state);
-                    cosmoV_pushNumber(state, -(cosmoV_readNumber(*val)));
-                } else {
-                    cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
-                }
-            }
-            CASE(OP_COUNT) :
-            {
-                StkPtr temp = cosmoV_getTop(state, 0);
+    return -1;
+}
+#endif
 
-                if (!IS_REF(*temp)) {
-                    cosmoV_error(state, "Expected non-primitive, got %s!", cosmoV_typeStr(*temp));
-                }
+// cosmoV_step works directly on the frame, since it only runs a single instruction
+#undef READBYTE
+#undef READUINT
+#undef PC
+#undef BASE
+#undef SAVEPC
+#undef LOADPC
+#undef QUICKEN
+#undef UNQUICKEN
+#define PC            frame->pc
+#define BASE          frame->base
+#define SAVEPC()      /* no-op */
+#define LOADPC()      /* no-op */
+#define QUICKEN(op)   PC[-1] = op
+#define UNQUICKEN(op) *(--PC) = op
+
+#undef CASE
+#define CASE(op)                                                                                   \
+    continue;                                                                                      \
+    case op
 
-                int count = cosmoO_count(state, cosmoV_readRef(*temp));
-                cosmoV_pop(state);
+int cosmoV_step(CState *state)
+{
+    CCallFrame *frame = &state->callFrame[state->frameCount - 1];
+    CValue *constants = frame->closure->function->chunk.constants.values;
+    INSTRUCTION *start = frame->pc;
 
-                cosmoV_pushNumber(state, count); // pushes the count onto the stack
-            }
-            CASE(OP_CONCAT) :
-            {
-                uint8_t vals = READBYTE(frame);
-                cosmoV_concat(state, vals);
-            }
-            CASE(OP_INCLOCAL) :
-            {                                       // this leaves the value on the stack
-                int8_t inc = READBYTE(frame) - 128; // amount we're incrementing by
-                uint8_t indx = READBYTE(frame);
-                StkPtr val = &frame->base[indx];
-
-                // check that it's a number value
-                if (IS_NUMBER(*val)) {
-                    cosmoV_pushValue(state, *val); // pushes old value onto the stack :)
-                    *val = cosmoV_newNumber(cosmoV_readNumber(*val) + inc);
-                } else {
-                    cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
-                }
-            }
-            CASE(OP_INCGLOBAL) :
-            {
-                int8_t inc = READBYTE(frame) - 128; // amount we're incrementing by
-                uint16_t indx = READUINT(frame);
-                CValue ident = constants[indx]; // grabs identifier
-                CValue *val = cosmoT_insert(state, &state->globals->tbl, ident);
-
-                // check that it's a number value
-                if (IS_NUMBER(*val)) {
-                    cosmoV_pushValue(state, *val); // pushes old value onto the stack :)
-                    *val = cosmoV_newNumber(cosmoV_readNumber(*val) + inc);
-                } else {
-                    cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
-                }
-            }
-            CASE(OP_INCUPVAL) :
-            {
-                int8_t inc = READBYTE(frame) - 128; // amount we're incrementing by
-                uint8_t indx = READBYTE(frame);
-                CValue *val = frame->closure->upvalues[indx]->val;
-
-                // check that it's a number value
-                if (IS_NUMBER(*val)) {
-                    cosmoV_pushValue(state, *val); // pushes old value onto the stack :)
-                    *val = cosmoV_newNumber(cosmoV_readNumber(*val) + inc);
-                } else {
-                    cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
-                }
-            }
-            CASE(OP_INCINDEX) :
-            {
-                int8_t inc = READBYTE(frame) - 128;    // amount we're incrementing by
-                StkPtr temp = cosmoV_getTop(state, 1); // object should be above the key
-                StkPtr key = cosmoV_getTop(state, 0);  // grabs key
-
-                if (!IS_REF(*temp)) {
-                    cosmoV_error(state, "Couldn't index non-indexable type %s!",
-                                 cosmoV_typeStr(*temp));
-                }
-
-                CObj *obj = cosmoV_readRef(*temp);
-                CObjObject *proto = cosmoO_grabProto(obj);
-                CValue val;
-
-                // call __index if the proto was found
-                if (proto != NULL) {
-                    cosmoO_indexObject(state, proto, *key, &val);
-
-                    if (!IS_NUMBER(val)) {
-                        cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(val));
-                    }
-
-                    cosmoV_pushValue(state, val); // pushes old value onto the stack :)
-
-                    // call __newindex
-                    cosmoO_newIndexObject(state, proto, *key,
-                                          cosmoV_newNumber(cosmoV_readNumber(val) + inc));
-                } else if (obj->type == COBJ_TABLE) {
-                    CObjTable *tbl = (CObjTable *)obj;
-                    CValue *val = cosmoT_insert(state, &tbl->tbl, *key);
-
-                    if (!IS_NUMBER(*val)) {
-                        cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
-                    }
-
-                    // pops tbl & key from stack
-                    cosmoV_setTop(state, 2);
-                    cosmoV_pushValue(state, *val); // pushes old value onto the stack :)
-                    *val = cosmoV_newNumber(cosmoV_readNumber(*val) + inc); // sets table index
-                } else {
-                    cosmoV_error(state, "No proto defined! Couldn't __index from type %s",
-                                 cosmoV_typeStr(*temp));
-                }
-            }
-            CASE(OP_INCOBJECT) :
-            {
-                int8_t inc = READBYTE(frame) - 128; // amount we're incrementing by
-                uint16_t indx = READUINT(frame);
-                StkPtr temp = cosmoV_getTop(state, 0); // object should be at the top of the stack
-                CValue ident = constants[indx];        // grabs identifier
-
-                // sanity check
-                if (IS_REF(*temp)) {
-                    CObj *obj = cosmoV_readRef(*temp);
-                    CValue val;
-
-                    cosmoV_rawget(state, obj, ident, &val);
-
-                    // pop the object off the stack
-                    cosmoV_pop(state);
-
-                    // check that it's a number value
-                    if (IS_NUMBER(val)) {
-                        cosmoV_pushValue(state, val); // pushes old value onto the stack :)
-                        cosmoV_rawset(state, obj, ident,
-                                      cosmoV_newNumber(cosmoV_readNumber(val) + inc));
-                    } else {
-                        cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(val));
-                    }
-                } else {
-                    cosmoV_error(state, "Couldn't set a field on type %s!", cosmoV_typeStr(*temp));
-                }
-            }
-            CASE(OP_EQUAL) :
-            {
-                // pop vals
-                StkPtr valB = cosmoV_pop(state);
-                StkPtr valA = cosmoV_pop(state);
-
-                // compare & push
-                cosmoV_pushBoolean(state, cosmoV_equal(state, *valA, *valB));
-            }
-            CASE(OP_LESS) :
-            {
-                NUMBEROP(cosmoV_newBoolean, <);
-            }
-            CASE(OP_GREATER) :
-            {
-                NUMBEROP(cosmoV_newBoolean, >);
-            }
-            CASE(OP_LESS_EQUAL) :
-            {
-                NUMBEROP(cosmoV_newBoolean, <=);
-            }
-            CASE(OP_GREATER_EQUAL) :
-            {
-                NUMBEROP(cosmoV_newBoolean, >=);
-            }
-            CASE(OP_TRUE) : cosmoV_pushBoolean(state, true);
-            CASE(OP_FALSE) : cosmoV_pushBoolean(state, false);
-            CASE(OP_NIL) : cosmoV_pushValue(state, cosmoV_newNil());
-            CASE(OP_RETURN) :
-            {
-                uint8_t res = READBYTE(frame);
-                return res;
-            }
-            DEFAULT;
+    // only runs again if a quickened instruction rewrote itself back to its generic opcode
+    do {
+        switch (READBYTE(frame)) {
+        default:
+            cosmoV_error(state, "unknown opcode!");
+#include "cvmops.h"
         }
-    }
+    } while (frame->pc == start);
 
     return -1;
 }
 
+#undef ARITH
+#undef COMPARE
+#undef BITWISEOP
 #undef NUMBEROP
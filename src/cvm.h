@@ -16,14 +16,45 @@
     although, this is disabled when VM_DEBUG is defined, since it can cause
     issues with debugging
 
-    BTW: be weary of maliciously crafted cosmo dumps!! it's very easy to crash
-    cosmo with this enabled and reading invalid opcodes due to us just using the
-    opcode as an index into the jump table
+    the opcode is used as an index into the jump table without any checks, cosmo dumps are
+    verified when they're loaded (see validateChunk) so invalid opcodes never reach the VM
 */
 #if (defined(__GNUC__) || defined(__clang__)) && !defined(VM_DEBUG)
 #    define VM_JUMPTABLE
 #endif
 
+/*
+    VM_TAILCALL builds the interpreter as one function per opcode instead of one big loop. each
+    handler ends in a guaranteed tail call to the next instruction's handler, so the state, frame,
+    pc, base & constants all stay in argument registers & every handler gets its own register
+    allocation. this takes priority over VM_JUMPTABLE, but needs the musttail attribute (clang 13+
+    or gcc 15+), otherwise it's ignored.
+*/
+// #define VM_TAILCALL
+
+#if defined(VM_TAILCALL) && defined(__has_attribute) && !defined(COSMO_MUSTTAIL)
+#    if __has_attribute(musttail)
+#        define COSMO_MUSTTAIL __attribute__((musttail))
+#    endif
+#endif
+
+#if defined(VM_TAILCALL) && (!defined(COSMO_MUSTTAIL) || defined(VM_DEBUG))
+#    undef VM_TAILCALL
+#endif
+
+/*
+    VM_THREADED makes the VM_JUMPTABLE loop run each function from a pre-decoded copy of its chunk,
+    built the first time the function is interpreted. every byte of the chunk gets a pointer sized
+    slot, an opcode's slot holds the address of its handler & an operand's slot holds its value, so
+    dispatching is a single load & jump with no table lookup or operand decoding. the byte buffer is
+    kept as is for dumps, the disassembler & the JIT. costs 8 bytes for every byte of bytecode
+*/
+// #define VM_THREADED
+
+#if defined(VM_THREADED) && (!defined(VM_JUMPTABLE) || defined(VM_TAILCALL))
+#    undef VM_THREADED
+#endif
+
 // args = # of pass parameters, nresults = # of expected results
 COSMO_API void cosmoV_call(CState *state, int args, int nresults);
 COSMO_API bool cosmoV_pcall(CState *state, int args, int nresults);
@@ -38,6 +69,15 @@ COSMO_API void cosmoV_throw(CState *state);
 COSMO_API void cosmoV_error(CState *state, const char *format, ...);
 COSMO_API void cosmoV_insert(CState *state, int indx, CValue val);
 
+// throws a stack overflow error unless there's room for needed more values on the stack. C
+// functions only need this if they push more than STACK_EXTRA values
+COSMO_API void cosmoV_checkStack(CState *state, int needed);
+
+// executes the single instruction at the current frame's pc, native code (see cjit.c & caot.c)
+// calls this for anything it doesn't translate itself. returns the result count if it was an
+// OP_RETURN, else -1
+COSMO_API int cosmoV_step(CState *state);
+
 /*
     Sets the default proto objects for the passed objType. Also walks through the object heap and
     updates protos for the passed objType if that CObj* has no proto.
@@ -85,20 +125,10 @@ COSMO_API bool cosmoV_isValueUserType(CState *state, CValue val, int userType);
 
 // nice to have wrappers
 
-// pushes a raw CValue to the stack, might throw an error if the stack is overflowed (with the
-// SAFE_STACK macro on)
+// pushes a raw CValue to the stack. this isn't checked, room for it was already made when the
+// function was called (see cosmoV_checkStack)
 static inline void cosmoV_pushValue(CState *state, CValue val)
 {
-#ifdef SAFE_STACK
-    ptrdiff_t stackSize = state->top - state->stack;
-
-    // we reserve 8 slots for the error string and whatever c api we might be in
-    if (stackSize >= STACK_MAX - 8) {
-        cosmoV_error(state, "Stack overflow!");
-        return;
-    }
-#endif
-
     *(state->top++) = val;
 }
 
@@ -124,7 +154,13 @@ static inline StkPtr cosmoV_pop(CState *state)
 // pushes a cosmo_Number to the stack
 static inline void cosmoV_pushNumber(CState *state, cosmo_Number num)
 {
-    cosmoV_pushValue(state, cosmoV_newNumber(num));
+    cosmoV_pushValue(state, cosmoV_newNumber(cosmoV_canonNumber(num)));
+}
+
+// pushes a cosmo_Integer to the stack, it's pushed as a double if it doesn't fit
+static inline void cosmoV_pushInteger(CState *state, cosmo_Integer num)
+{
+    cosmoV_pushValue(state, cosmoV_makeInteger(num));
 }
 
 // pushes a boolean to the stack
@@ -0,0 +1,753 @@
+/*
+    opcode bodies for the interpreter, deliberately without an include guard. this file is included
+    by every loop in cvm.c that executes bytecode, each one defining CASE(op) to fit its own
+    dispatch. bodies expect `state`, `frame` & `constants` to be in scope, operands are read
+    through READBYTE() & READUINT() and the instruction pointer & stack base are only touched
+    through PC & BASE, so a loop is free to keep them somewhere other than the frame. quickening
+    rewrites the current instruction through QUICKEN() & UNQUICKEN() (which also rewinds to it)
+*/
+
+CASE(OP_LOADCONST) :
+{ // push const[uint] to stack
+    uint16_t indx = READUINT(frame);
+    cosmoV_pushValue(state, constants[indx]);
+}
+CASE(OP_SETGLOBAL) :
+{
+    uint16_t indx = READUINT(frame);
+    CObjFunction *func = frame->closure->function;
+    CValue *val = getGlobalSlot(state, func, indx);
+
+    if (val == NULL)
+        val = resolveGlobal(state, func, indx, true);
+
+    *val = *cosmoV_pop(state); // sets the value in the hash table
+}
+CASE(OP_GETGLOBAL) :
+{
+    uint16_t indx = READUINT(frame);
+    CObjFunction *func = frame->closure->function;
+    CValue *val = getGlobalSlot(state, func, indx);
+
+    if (val == NULL && (val = resolveGlobal(state, func, indx, false)) == NULL) {
+        cosmoV_pushValue(state, cosmoV_newNil()); // undefined globals are nil
+    } else {
+        cosmoV_pushValue(state, *val); // pushes the value to the stack
+    }
+}
+CASE(OP_SETLOCAL) :
+{
+    uint8_t indx = READBYTE(frame);
+    // set base to top of stack & pop
+    BASE[indx] = *cosmoV_pop(state);
+}
+CASE(OP_GETLOCAL) :
+{
+    uint8_t indx = READBYTE(frame);
+    cosmoV_pushValue(state, BASE[indx]);
+}
+CASE(OP_GETUPVAL) :
+{
+    uint8_t indx = READBYTE(frame);
+    cosmoV_pushValue(state, *frame->closure->upvalues[indx]->val);
+}
+CASE(OP_SETUPVAL) :
+{
+    uint8_t indx = READBYTE(frame);
+    *frame->closure->upvalues[indx]->val = *cosmoV_pop(state);
+}
+CASE(OP_PEJMP) :
+{ // pop equality jump
+    uint16_t offset = READUINT(frame);
+
+    if (isFalsey(cosmoV_pop(state))) { // pop, if the condition is false, jump!
+        PC += offset;
+    }
+}
+CASE(OP_EJMP) :
+{ // equality jump
+    uint16_t offset = READUINT(frame);
+
+    if (isFalsey(cosmoV_getTop(state, 0))) { // if the condition is false, jump!
+        PC += offset;
+    }
+}
+CASE(OP_JMP) :
+{ // jump
+    uint16_t offset = READUINT(frame);
+    PC += offset;
+}
+CASE(OP_JMPBACK) :
+{
+    uint16_t offset = READUINT(frame);
+    PC -= offset;
+#ifdef COSMO_JIT
+    SAVEPC();
+    cosmoJ_backEdge(state, frame); // hot loops are traced
+    LOADPC();
+#endif
+}
+CASE(OP_POP) :
+{ // pops value off the stack
+    cosmoV_setTop(state, READBYTE(frame));
+}
+CASE(OP_CALL) :
+{
+    uint8_t args = READBYTE(frame);
+    uint8_t nres = READBYTE(frame);
+    cosmoV_call(state, args, nres);
+}
+CASE(OP_CLOSURE) :
+{
+    uint16_t index = READUINT(frame);
+    CObjFunction *func = cosmoV_readFunction(constants[index]);
+
+    // functions that don't capture anything can all share the same closure
+    if (func->upvals == 0) {
+        if (func->closure == NULL)
+            func->closure = cosmoO_newClosure(state, func);
+
+        cosmoV_pushRef(state, (CObj *)func->closure);
+    } else {
+        CObjClosure *closure = cosmoO_newClosure(state, func);
+        cosmoV_pushRef(state, (CObj *)closure);
+
+        for (int i = 0; i < closure->upvalueCount; i++) {
+            uint8_t encoding = READBYTE(frame);
+            uint8_t index = READBYTE(frame);
+            if (encoding == OP_GETUPVAL) {
+                // capture upvalue from current frame's closure
+                closure->upvalues[i] = frame->closure->upvalues[index];
+            } else {
+                // capture local
+                closure->upvalues[i] =
+                    captureUpvalue(state, frame, BASE + index);
+            }
+        }
+    }
+}
+CASE(OP_CLOSE) :
+{
+    closeUpvalues(frame, state->top - 1);
+    cosmoV_pop(state);
+}
+CASE(OP_NEWTABLE) :
+{
+    uint16_t pairs = READUINT(frame);
+    cosmoV_makeTable(state, pairs);
+}
+CASE(OP_NEWARRAY) :
+{
+    uint16_t pairs = READUINT(frame);
+    StkPtr val;
+    CObjTable *newObj = cosmoO_newTableSized(state, pairs);
+    cosmoV_pushRef(state, (CObj *)newObj); // so our GC doesn't free our new table
+
+    for (int i = 0; i < pairs; i++) {
+        val = cosmoV_getTop(state, i + 1);
+
+        // set key/value pair
+        CValue *newVal =
+            cosmoT_insert(state, &newObj->tbl, cosmoV_newInteger(pairs - i - 1));
+        *newVal = *val;
+    }
+
+    // once done, pop everything off the stack + push new table
+    cosmoV_setTop(state, pairs + 1); // + 1 for our table
+    cosmoV_pushRef(state, (CObj *)newObj);
+}
+CASE(OP_INDEX) :
+{
+    StkPtr key = cosmoV_getTop(state, 0);  // key should be the top of the stack
+    StkPtr temp = cosmoV_getTop(state, 1); // after that should be the table
+
+    // sanity check
+    if (!IS_REF(*temp)) {
+        cosmoV_error(state, "Couldn't index type %s!", cosmoV_typeStr(*temp));
+    }
+
+    CObj *obj = cosmoV_readRef(*temp);
+    CObjObject *proto = cosmoO_grabProto(obj);
+    CValue val = cosmoV_newNil(); // to hold our value
+
+    if (proto != NULL) {
+        // check for __index metamethod
+        cosmoO_indexObject(state, proto, *key, &val);
+    } else if (obj->type == COBJ_TABLE) {
+        CObjTable *tbl = (CObjTable *)obj;
+
+        QUICKEN(OP_INDEX_TBL); // plain table
+        cosmoT_get(state, &tbl->tbl, *key, &val);
+    } else {
+        cosmoV_error(state, "No proto defined! Couldn't __index from type %s",
+                     cosmoV_typeStr(*temp));
+    }
+
+    cosmoV_setTop(state, 2);      // pops the table & the key
+    cosmoV_pushValue(state, val); // pushes the field result
+}
+CASE(OP_NEWINDEX) :
+{
+    StkPtr value = cosmoV_getTop(state, 0); // value is at the top of the stack
+    StkPtr key = cosmoV_getTop(state, 1);
+    StkPtr temp = cosmoV_getTop(state, 2); // table is after the key
+
+    // sanity check
+    if (!IS_REF(*temp)) {
+        cosmoV_error(state, "Couldn't set index with type %s!", cosmoV_typeStr(*temp));
+    }
+
+    CObj *obj = cosmoV_readRef(*temp);
+    CObjObject *proto = cosmoO_grabProto(obj);
+
+    if (proto != NULL) {
+        cosmoO_newIndexObject(state, proto, *key, *value);
+    } else if (obj->type == COBJ_TABLE) {
+        CObjTable *tbl = (CObjTable *)obj;
+        CValue *newVal = cosmoT_insert(state, &tbl->tbl, *key);
+
+        *newVal = *value; // set the index
+    } else {
+        cosmoV_error(state, "No proto defined! Couldn't __newindex from type %s",
+                     cosmoV_typeStr(*temp));
+    }
+
+    // pop everything off the stack
+    cosmoV_setTop(state, 3);
+}
+CASE(OP_NEWOBJECT) :
+{
+    uint16_t pairs = READUINT(frame);
+    cosmoV_makeObject(state, pairs);
+}
+CASE(OP_SETOBJECT) :
+{
+    StkPtr value = cosmoV_getTop(state, 0); // value is at the top of the stack
+    StkPtr temp = cosmoV_getTop(state, 1);  // object is after the value
+    uint16_t ident = READUINT(frame);       // use for the key
+
+    // sanity check
+    if (IS_REF(*temp)) {
+        cosmoV_rawset(state, cosmoV_readRef(*temp), constants[ident], *value);
+    } else {
+        CObjString *field = cosmoV_toString(state, constants[ident]);
+        cosmoV_error(state, "Couldn't set field '%s' on type %s!", field->str,
+                     cosmoV_typeStr(*temp));
+    }
+
+    // pop everything off the stack
+    cosmoV_setTop(state, 2);
+}
+CASE(OP_GETOBJECT) :
+{
+    CValue val = cosmoV_newNil();          // to hold our value
+    StkPtr temp = cosmoV_getTop(state, 0); // that should be the object
+    uint16_t ident = READUINT(frame);      // use for the key
+
+    // sanity check
+    if (IS_REF(*temp)) {
+        cosmoV_rawget(state, cosmoV_readRef(*temp), constants[ident], &val);
+    } else {
+        CObjString *field = cosmoV_toString(state, constants[ident]);
+        cosmoV_error(state, "Couldn't get field '%s' from type %s!", field->str,
+                     cosmoV_typeStr(*temp));
+    }
+
+    cosmoV_setTop(state, 1);      // pops the object
+    cosmoV_pushValue(state, val); // pushes the field result
+}
+CASE(OP_GETMETHOD) :
+{
+    CValue val = cosmoV_newNil();          // to hold our value
+    StkPtr temp = cosmoV_getTop(state, 0); // that should be the object
+    uint16_t ident = READUINT(frame);      // use for the key
+
+    // this is almost identical to GETOBJECT, however cosmoV_getMethod is used instead
+    // of just cosmoV_get
+    if (IS_REF(*temp)) {
+        cosmoV_getMethod(state, cosmoV_readRef(*temp), constants[ident], &val);
+    } else {
+        CObjString *field = cosmoV_toString(state, constants[ident]);
+        cosmoV_error(state, "Couldn't get field '%s' from type %s!", field->str,
+                     cosmoV_typeStr(*temp));
+    }
+
+    cosmoV_setTop(state, 1);      // pops the object
+    cosmoV_pushValue(state, val); // pushes the field result
+}
+CASE(OP_INVOKE) :
+{
+    uint8_t args = READBYTE(frame);
+    uint8_t nres = READBYTE(frame);
+    uint16_t ident = READUINT(frame);
+    StkPtr temp = cosmoV_getTop(state, args); // grabs object from stack
+    CValue val;                               // to hold our value
+
+    // sanity check
+    if (IS_REF(*temp)) {
+        // get the field from the object
+        cosmoV_rawget(state, cosmoV_readRef(*temp), constants[ident], &val);
+
+        // now invoke the method!
+        invokeMethod(state, cosmoV_readRef(*temp), val, args, nres, 1);
+    } else {
+        cosmoV_error(state, "Couldn't get from type %s!", cosmoV_typeStr(*temp));
+    }
+}
+CASE(OP_ITER) :
+{
+    StkPtr temp = cosmoV_getTop(state, 0); // should be the object/table
+
+    if (!IS_REF(*temp)) {
+        cosmoV_error(state, "Couldn't iterate over non-iterator type %s!",
+                     cosmoV_typeStr(*temp));
+    }
+
+    CObj *obj = cosmoV_readRef(*temp);
+    CObjObject *proto = cosmoO_grabProto(obj);
+    CValue val;
+
+    if (proto != NULL) {
+        // grab __iter & call it
+        if (cosmoO_getIString(state, proto, ISTRING_ITER, &val)) {
+            cosmoV_pop(state); // pop the object from the stack
+            cosmoV_pushValue(state, val);
+            cosmoV_pushRef(state, (CObj *)obj);
+            cosmoV_call(
+                state, 1,
+                1); // we expect 1 return value on the stack, the iterable object
+
+            StkPtr iObj = cosmoV_getTop(state, 0);
+
+            if (!IS_OBJECT(*iObj)) {
+                cosmoV_error(state,
+                             "Expected iterable object! '__iter' returned %s, expected "
+                             "<object>!",
+                             cosmoV_typeStr(*iObj));
+            }
+
+            // get __next method and place it at the top of the stack
+            cosmoV_getMethod(state, cosmoV_readRef(*iObj),
+                             cosmoV_newRef(state->iStrings[ISTRING_NEXT]), iObj);
+        } else {
+            cosmoV_error(state, "Expected iterable object! '__iter' not defined!");
+        }
+    } else if (obj->type == COBJ_TABLE) {
+        CObjTable *tbl = (CObjTable *)obj;
+
+        cosmoV_pushRef(state, (CObj *)state->iStrings[ISTRING_RESERVED]); // key
+        cosmoV_pushRef(state, (CObj *)tbl);                               // value
+
+        cosmoV_pushString(state, "__next"); // key
+        CObjCFunction *tbl_next = cosmoO_newCFunction(state, _tbl__next);
+        cosmoV_pushRef(state, (CObj *)tbl_next); // value
+
+        CObjObject *obj =
+            cosmoV_makeObject(state, 2); // pushes the new object to the stack
+        cosmoO_setUserI(obj, 0);         // increment for iterator
+
+        // make our CObjMethod for OP_NEXT to call
+        CObjMethod *method =
+            cosmoO_newMethod(state, cosmoV_newRef(tbl_next), (CObj *)obj);
+
+        cosmoV_setTop(state, 2);               // pops the object & the tbl
+        cosmoV_pushRef(state, (CObj *)method); // pushes the method for OP_NEXT
+    } else {
+        cosmoV_error(state, "No proto defined! Couldn't get from type %s",
+                     cosmoO_typeStr(obj));
+    }
+}
+CASE(OP_NEXT) :
+{
+    uint8_t nresults = READBYTE(frame);
+    uint16_t jump = READUINT(frame);
+    StkPtr temp = cosmoV_getTop(state, 0); // we don't actually pop this off the stack
+
+    if (!IS_METHOD(*temp)) {
+        cosmoV_error(state, "Expected '__next' to be a method, got type %s!",
+                     cosmoV_typeStr(*temp));
+    }
+
+    cosmoV_pushValue(state, *temp);
+    cosmoV_call(state, 0, nresults);
+
+    if (IS_NIL(*(cosmoV_getTop(
+            state, 0)))) { // __next returned a nil, which means to exit the loop
+        cosmoV_setTop(state, nresults); // pop the return values
+        PC += jump;
+    }
+}
+CASE(OP_ADD) :
+{
+    // pop 2 values off the stack & try to add them together
+    NUMBEROP(ARITH(cosmoV_addInteger, +), OP_ADD_INT, OP_ADD_FLOAT);
+}
+CASE(OP_SUB) :
+{
+    // pop 2 values off the stack & try to subtracts them
+    NUMBEROP(ARITH(cosmoV_subInteger, -), OP_SUB_INT, OP_SUB_FLOAT);
+}
+CASE(OP_MULT) :
+{
+    // pop 2 values off the stack & try to multiplies them together
+    NUMBEROP(ARITH(cosmoV_mulInteger, *), OP_MULT_INT, OP_MULT_FLOAT);
+}
+CASE(OP_DIV) :
+{
+    // pop 2 values off the stack & try to divides them
+    NUMBEROP(ARITH(cosmoV_divInteger, /), OP_DIV_INT, OP_DIV_FLOAT);
+}
+CASE(OP_MOD) :
+{
+    StkPtr valA = cosmoV_getTop(state, 1);
+    StkPtr valB = cosmoV_getTop(state, 0);
+    if (IS_INTEGER(*valA) && IS_INTEGER(*valB) && cosmoV_readInteger(*valB) != 0) {
+        cosmo_Integer b = cosmoV_readInteger(*valB);
+
+        // % truncates like fmod, & INT64_MIN % -1 would trap
+        *valA = cosmoV_newInteger(b == -1 ? 0 : cosmoV_readInteger(*valA) % b);
+        state->top--;
+    } else if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {
+        cosmoV_setTop(state, 2); /* pop the 2 values */
+        cosmoV_pushValue(state, cosmoV_newNumber(fmod(cosmoV_readNumber(*valA),
+                                                      cosmoV_readNumber(*valB))));
+    } else {
+        cosmoV_error(state, "Expected numbers, got %s and %s!", cosmoV_typeStr(*valA),
+                     cosmoV_typeStr(*valB));
+    }
+}
+CASE(OP_POW) :
+{
+    StkPtr valA = cosmoV_getTop(state, 1);
+    StkPtr valB = cosmoV_getTop(state, 0);
+    if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {
+        cosmoV_setTop(state, 2); /* pop the 2 values */
+        cosmoV_pushValue(state, cosmoV_newNumber(pow(cosmoV_readNumber(*valA),
+                                                     cosmoV_readNumber(*valB))));
+    } else {
+        cosmoV_error(state, "Expected numbers, got %s and %s!", cosmoV_typeStr(*valA),
+                     cosmoV_typeStr(*valB));
+    }
+}
+CASE(OP_IDIV) :
+{
+    StkPtr valA = cosmoV_getTop(state, 1);
+    StkPtr valB = cosmoV_getTop(state, 0);
+    if (IS_INTEGER(*valA) && IS_INTEGER(*valB)) {
+        cosmo_Integer a = cosmoV_readInteger(*valA);
+        cosmo_Integer b = cosmoV_readInteger(*valB);
+
+        if (b == 0)
+            cosmoV_error(state, "Integer division by zero!");
+
+        // INT64_MIN / -1 would trap
+        *valA = b == -1 ? cosmoV_subInteger(0, a) : cosmoV_newInteger(a / b);
+        state->top--;
+    } else if (IS_NUMBER(*valA) && IS_NUMBER(*valB)) {
+        *valA = cosmoV_newNumber(trunc(cosmoV_readNumber(*valA) / cosmoV_readNumber(*valB)));
+        state->top--;
+    } else {
+        cosmoV_error(state, "Expected numbers, got %s and %s!", cosmoV_typeStr(*valA),
+                     cosmoV_typeStr(*valB));
+    }
+}
+CASE(OP_BAND) :
+{
+    BITWISEOP(a & b);
+}
+CASE(OP_BOR) :
+{
+    BITWISEOP(a | b);
+}
+CASE(OP_BXOR) :
+{
+    BITWISEOP(a ^ b);
+}
+CASE(OP_SHL) :
+{
+    BITWISEOP(shiftLeft(a, b));
+}
+CASE(OP_SHR) :
+{
+    BITWISEOP(shiftRight(a, b));
+}
+CASE(OP_BNOT) :
+{
+    StkPtr val = cosmoV_getTop(state, 0);
+    cosmo_Integer num;
+
+    if (cosmoV_asInteger(*val, &num)) {
+        *val = cosmoV_newInteger(~num);
+    } else if (IS_NUMBER(*val)) {
+        cosmoV_error(state, "Number has no integer representation!");
+    } else {
+        cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
+    }
+}
+CASE(OP_NOT) :
+{
+    cosmoV_pushBoolean(state, isFalsey(cosmoV_pop(state)));
+}
+CASE(OP_NEGATE) :
+{ // pop 1 value off the stack & try to negate
+    StkPtr val = cosmoV_getTop(state, 0);
+
+    if (IS_INTEGER(*val)) {
+        *val = cosmoV_subInteger(0, cosmoV_readInteger(*val));
+    } else if (IS_NUMBER(*val)) {
+        cosmoV_pop(state);
+        cosmoV_pushNumber(state, -(cosmoV_readNumber(*val)));
+    } else {
+        cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
+    }
+}
+CASE(OP_COUNT) :
+{
+    StkPtr temp = cosmoV_getTop(state, 0);
+
+    if (!IS_REF(*temp)) {
+        cosmoV_error(state, "Expected non-primitive, got %s!", cosmoV_typeStr(*temp));
+    }
+
+    int count = cosmoO_count(state, cosmoV_readRef(*temp));
+    cosmoV_pop(state);
+
+    cosmoV_pushInteger(state, count); // pushes the count onto the stack
+}
+CASE(OP_CONCAT) :
+{
+    uint8_t vals = READBYTE(frame);
+    cosmoV_concat(state, vals);
+}
+CASE(OP_INCLOCAL) :
+{                                       // this leaves the value on the stack
+    int8_t inc = READBYTE(frame) - 128; // amount we're incrementing by
+    uint8_t indx = READBYTE(frame);
+    StkPtr val = &BASE[indx];
+
+    // check that it's a number value
+    if (IS_NUMBER(*val)) {
+        cosmoV_pushValue(state, *val); // pushes old value onto the stack :)
+        *val = cosmoV_incNumber(*val, inc);
+    } else {
+        cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
+    }
+}
+CASE(OP_INCGLOBAL) :
+{
+    int8_t inc = READBYTE(frame) - 128; // amount we're incrementing by
+    uint16_t indx = READUINT(frame);
+    CObjFunction *func = frame->closure->function;
+    CValue *val = getGlobalSlot(state, func, indx);
+
+    if (val == NULL)
+        val = resolveGlobal(state, func, indx, true);
+
+    // check that it's a number value
+    if (IS_NUMBER(*val)) {
+        cosmoV_pushValue(state, *val); // pushes old value onto the stack :)
+        *val = cosmoV_incNumber(*val, inc);
+    } else {
+        cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
+    }
+}
+CASE(OP_INCUPVAL) :
+{
+    int8_t inc = READBYTE(frame) - 128; // amount we're incrementing by
+    uint8_t indx = READBYTE(frame);
+    CValue *val = frame->closure->upvalues[indx]->val;
+
+    // check that it's a number value
+    if (IS_NUMBER(*val)) {
+        cosmoV_pushValue(state, *val); // pushes old value onto the stack :)
+        *val = cosmoV_incNumber(*val, inc);
+    } else {
+        cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
+    }
+}
+CASE(OP_INCINDEX) :
+{
+    int8_t inc = READBYTE(frame) - 128;    // amount we're incrementing by
+    StkPtr temp = cosmoV_getTop(state, 1); // object should be above the key
+    StkPtr key = cosmoV_getTop(state, 0);  // grabs key
+
+    if (!IS_REF(*temp)) {
+        cosmoV_error(state, "Couldn't index non-indexable type %s!",
+                     cosmoV_typeStr(*temp));
+    }
+
+    CObj *obj = cosmoV_readRef(*temp);
+    CObjObject *proto = cosmoO_grabProto(obj);
+    CValue val;
+
+    // call __index if the proto was found
+    if (proto != NULL) {
+        cosmoO_indexObject(state, proto, *key, &val);
+
+        if (!IS_NUMBER(val)) {
+            cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(val));
+        }
+
+        cosmoV_pushValue(state, val); // pushes old value onto the stack :)
+
+        // call __newindex
+        cosmoO_newIndexObject(state, proto, *key,
+                              cosmoV_incNumber(val, inc));
+    } else if (obj->type == COBJ_TABLE) {
+        CObjTable *tbl = (CObjTable *)obj;
+        CValue *val = cosmoT_insert(state, &tbl->tbl, *key);
+
+        if (!IS_NUMBER(*val)) {
+            cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(*val));
+        }
+
+        // pops tbl & key from stack
+        cosmoV_setTop(state, 2);
+        cosmoV_pushValue(state, *val); // pushes old value onto the stack :)
+        *val = cosmoV_incNumber(*val, inc); // sets table index
+    } else {
+        cosmoV_error(state, "No proto defined! Couldn't __index from type %s",
+                     cosmoV_typeStr(*temp));
+    }
+}
+CASE(OP_INCOBJECT) :
+{
+    int8_t inc = READBYTE(frame) - 128; // amount we're incrementing by
+    uint16_t indx = READUINT(frame);
+    StkPtr temp = cosmoV_getTop(state, 0); // object should be at the top of the stack
+    CValue ident = constants[indx];        // grabs identifier
+
+    // sanity check
+    if (IS_REF(*temp)) {
+        CObj *obj = cosmoV_readRef(*temp);
+        CValue val;
+
+        cosmoV_rawget(state, obj, ident, &val);
+
+        // pop the object off the stack
+        cosmoV_pop(state);
+
+        // check that it's a number value
+        if (IS_NUMBER(val)) {
+            cosmoV_pushValue(state, val); // pushes old value onto the stack :)
+            cosmoV_rawset(state, obj, ident,
+                          cosmoV_incNumber(val, inc));
+        } else {
+            cosmoV_error(state, "Expected number, got %s!", cosmoV_typeStr(val));
+        }
+    } else {
+        cosmoV_error(state, "Couldn't set a field on type %s!", cosmoV_typeStr(*temp));
+    }
+}
+CASE(OP_EQUAL) :
+{
+    // pop vals
+    StkPtr valB = cosmoV_pop(state);
+    StkPtr valA = cosmoV_pop(state);
+
+    // compare & push
+    cosmoV_pushBoolean(state, cosmoV_equal(state, *valA, *valB));
+}
+CASE(OP_LESS) :
+{
+    NUMBEROP(COMPARE(<), OP_LESS_INT, OP_LESS_FLOAT);
+}
+CASE(OP_GREATER) :
+{
+    NUMBEROP(COMPARE(>), OP_GREATER_INT, OP_GREATER_FLOAT);
+}
+CASE(OP_LESS_EQUAL) :
+{
+    NUMBEROP(COMPARE(<=), OP_LESS_EQUAL_INT, OP_LESS_EQUAL_FLOAT);
+}
+CASE(OP_GREATER_EQUAL) :
+{
+    NUMBEROP(COMPARE(>=), OP_GREATER_EQUAL_INT, OP_GREATER_EQUAL_FLOAT);
+}
+CASE(OP_TRUE) : cosmoV_pushBoolean(state, true);
+CASE(OP_FALSE) : cosmoV_pushBoolean(state, false);
+CASE(OP_NIL) : cosmoV_pushValue(state, cosmoV_newNil());
+CASE(OP_RETURN) :
+{
+    uint8_t res = READBYTE(frame);
+    return res;
+}
+CASE(OP_ADD_INT) :
+{
+    QUICKOP(IS_INTEGER, INTARITH(cosmoV_addInteger), OP_ADD);
+}
+CASE(OP_SUB_INT) :
+{
+    QUICKOP(IS_INTEGER, INTARITH(cosmoV_subInteger), OP_SUB);
+}
+CASE(OP_MULT_INT) :
+{
+    QUICKOP(IS_INTEGER, INTARITH(cosmoV_mulInteger), OP_MULT);
+}
+CASE(OP_DIV_INT) :
+{
+    QUICKOP(IS_INTEGER, INTARITH(cosmoV_divInteger), OP_DIV);
+}
+CASE(OP_LESS_INT) :
+{
+    QUICKOP(IS_INTEGER, INTCOMPARE(<), OP_LESS);
+}
+CASE(OP_GREATER_INT) :
+{
+    QUICKOP(IS_INTEGER, INTCOMPARE(>), OP_GREATER);
+}
+CASE(OP_LESS_EQUAL_INT) :
+{
+    QUICKOP(IS_INTEGER, INTCOMPARE(<=), OP_LESS_EQUAL);
+}
+CASE(OP_GREATER_EQUAL_INT) :
+{
+    QUICKOP(IS_INTEGER, INTCOMPARE(>=), OP_GREATER_EQUAL);
+}
+CASE(OP_ADD_FLOAT) :
+{
+    QUICKOP(IS_FLOAT, FLOATARITH(+), OP_ADD);
+}
+CASE(OP_SUB_FLOAT) :
+{
+    QUICKOP(IS_FLOAT, FLOATARITH(-), OP_SUB);
+}
+CASE(OP_MULT_FLOAT) :
+{
+    QUICKOP(IS_FLOAT, FLOATARITH(*), OP_MULT);
+}
+CASE(OP_DIV_FLOAT) :
+{
+    QUICKOP(IS_FLOAT, FLOATARITH(/), OP_DIV);
+}
+CASE(OP_LESS_FLOAT) :
+{
+    QUICKOP(IS_FLOAT, FLOATCOMPARE(<), OP_LESS);
+}
+CASE(OP_GREATER_FLOAT) :
+{
+    QUICKOP(IS_FLOAT, FLOATCOMPARE(>), OP_GREATER);
+}
+CASE(OP_LESS_EQUAL_FLOAT) :
+{
+    QUICKOP(IS_FLOAT, FLOATCOMPARE(<=), OP_LESS_EQUAL);
+}
+CASE(OP_GREATER_EQUAL_FLOAT) :
+{
+    QUICKOP(IS_FLOAT, FLOATCOMPARE(>=), OP_GREATER_EQUAL);
+}
+CASE(OP_INDEX_TBL) :
+{
+    StkPtr key = cosmoV_getTop(state, 0);
+    StkPtr temp = cosmoV_getTop(state, 1);
+
+    // guard: still a table without a proto?
+    if (IS_TABLE(*temp) && cosmoV_readRef(*temp)->proto == NULL) {
+        CValue val;
+        cosmoT_get(state, &cosmoV_readTable(*temp)->tbl, *key, &val);
+        cosmoV_setTop(state, 1); // pops the key
+        *temp = val;             // replaces the table with the field result
+    } else {
+        UNQUICKEN(OP_INDEX);
+    }
+}
@@ -0,0 +1,31 @@
+#include "cbaselib.h"
+#include "cosmo.h"
+#include "cstate.h"
+#include "cvm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    runs a script compiled to C with `cosmo -C`, the build defines COSMO_AOT_LOADER as the
+    cosmo_load_<name> function the generated file exposes
+*/
+
+bool COSMO_AOT_LOADER(CState *state);
+
+int main(void)
+{
+    CState *state = cosmoV_newState();
+    cosmoB_loadLibrary(state);
+    cosmoB_loadOS(state);
+    cosmoB_loadVM(state);
+
+    if (!COSMO_AOT_LOADER(state) || !cosmoV_pcall(state, 0, 0)) {
+        cosmoV_printBacktrace(state, cosmoV_readError(*cosmoV_pop(state)));
+        cosmoV_freeState(state);
+        return EXIT_FAILURE;
+    }
+
+    cosmoV_freeState(state);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,26 @@
+# compiles a script with a function name that's longer than any line -C usually writes, the
+# generated C has to keep the whole name
+# usage: cmake -DCOSMO=<cosmo binary> -DWORK_DIR=<scratch dir> -P aotnames.cmake
+
+cmake_minimum_required(VERSION 3.10)
+
+# string(REPEAT) needs cmake 3.15, so double a 25 character name up to 400 characters
+set(name "aaaaaaaaaaaaaaaaaaaaaaaaa")
+foreach(i RANGE 1 4)
+    set(name "${name}${name}")
+endforeach()
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(WRITE ${WORK_DIR}/longname.cosmo
+     "local func ${name}()\n    return 1\nend\n\nassert(${name}() == 1)\n")
+
+execute_process(COMMAND ${COSMO} -C ${WORK_DIR}/longname.cosmo ${WORK_DIR}/longname.c
+                RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "failed to compile a long function name to C!\n${output}")
+endif()
+
+file(READ ${WORK_DIR}/longname.c source)
+string(FIND "${source}" "// ${name}\n" found)
+if (found EQUAL -1)
+    message(FATAL_ERROR "the generated C lost the long function name!")
+endif()
@@ -0,0 +1,70 @@
+# compiles every example to a dump with -c, then loads & runs the dump with -l. the same goes for a
+# dump without line info from -S, which has to be smaller & behave the same
+# usage: cmake -DCOSMO=<cosmo binary> -DSOURCE_DIR=<repo root> -DWORK_DIR=<scratch dir>
+#              -P roundtrip.cmake
+
+cmake_minimum_required(VERSION 3.10)
+
+# fibtest & compare are benchmarks that take way too long, increment still uses the old anonymous
+# function syntax and doesn't compile
+set(SKIPPED fibtest compare increment)
+
+# examples/reader.cosmo opens LICENSE.md & examples/writer.cosmo writes test.md, so run them from a
+# scratch directory instead of the source tree
+file(MAKE_DIRECTORY ${WORK_DIR} ${WORK_DIR}/stripped)
+file(COPY ${SOURCE_DIR}/LICENSE.md DESTINATION ${WORK_DIR})
+file(COPY ${SOURCE_DIR}/LICENSE.md DESTINATION ${WORK_DIR}/stripped)
+
+# runs a dump from its own directory, the disassembly is left out of the output since it's the only
+# thing that shows line info
+function(load_dump dir name out)
+    execute_process(COMMAND ${COSMO} -l ${name}.cdump WORKING_DIRECTORY ${dir}
+                    RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE output)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "failed to load ${dir}/${name}.cdump!\n${output}")
+    endif()
+
+    string(REGEX REPLACE "\n\t*[0-9][0-9][0-9][0-9] [^\n]*" "" output "\n${output}")
+    set(${out} "${output}" PARENT_SCOPE)
+endfunction()
+
+# file(SIZE) needs cmake 3.14
+function(dump_size path out)
+    file(READ ${path} contents HEX)
+    string(LENGTH "${contents}" size)
+    math(EXPR size "${size} / 2")
+    set(${out} ${size} PARENT_SCOPE)
+endfunction()
+
+file(GLOB examples ${SOURCE_DIR}/examples/*.cosmo)
+foreach(example ${examples})
+    get_filename_component(name ${example} NAME_WE)
+    if (name IN_LIST SKIPPED)
+        continue()
+    endif()
+
+    execute_process(COMMAND ${COSMO} -c ${example} ${WORK_DIR}/${name}.cdump
+                    WORKING_DIRECTORY ${WORK_DIR} RESULT_VARIABLE result OUTPUT_QUIET)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "failed to dump ${example}!")
+    endif()
+
+    execute_process(COMMAND ${COSMO} -S ${example} ${WORK_DIR}/stripped/${name}.cdump
+                    WORKING_DIRECTORY ${WORK_DIR} RESULT_VARIABLE result OUTPUT_QUIET)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "failed to dump ${example} without line info!")
+    endif()
+
+    dump_size(${WORK_DIR}/${name}.cdump size)
+    dump_size(${WORK_DIR}/stripped/${name}.cdump strippedSize)
+    if (NOT strippedSize LESS size)
+        message(FATAL_ERROR "-S didn't shrink the dump of ${example}!")
+    endif()
+
+    load_dump(${WORK_DIR} ${name} output)
+    load_dump(${WORK_DIR}/stripped ${name} strippedOutput)
+    if (NOT output STREQUAL strippedOutput)
+        message(FATAL_ERROR "the dumps of ${example} behave differently without line info!\n"
+                            "${output}\n${strippedOutput}")
+    endif()
+endforeach()